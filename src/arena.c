@@ -0,0 +1,150 @@
+/**
+ * @file    arena.c
+ * @brief   Implementation of the region allocator, and of polynomials and
+ *          matrices allocated from it.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+/* --- function prototypes ---------------------------------------------------*/
+
+static void *bump(Arena *A, size_t size, size_t align);
+static ArenaBlock *new_block(size_t size);
+
+/* --- arena interface -------------------------------------------------------*/
+
+Arena *init_arena(size_t block_size)
+{
+	Arena *A = malloc(sizeof(Arena));
+	A->blocks = NULL;
+	A->block_size = block_size;
+	return A;
+}
+
+void free_arena(Arena *A)
+{
+	ArenaBlock *next;
+	for (ArenaBlock *B = A->blocks; B; B = next) {
+		next = B->next;
+		free(B->data);
+		free(B);
+	}
+	free(A);
+}
+
+void reset_arena(Arena *A)
+{
+	if (!A->blocks) {
+		return;
+	}
+
+	/* one block this large fits everything that was just allocated */
+	if (A->blocks->next) {
+		size_t total = 0;
+		ArenaBlock *next;
+		for (ArenaBlock *B = A->blocks; B; B = next) {
+			next = B->next;
+			total += B->size;
+			free(B->data);
+			free(B);
+		}
+		A->blocks = new_block(total);
+	}
+
+	A->blocks->used = 0;
+}
+
+void *arena_alloc(Arena *A, size_t size)
+{
+	return bump(A, size, ARENA_ALIGN);
+}
+
+Polynomial *arena_polynomial(Arena *A, int degree)
+{
+	COUNT(polynomials, 1);
+	COUNT(bytes, sizeof(coeff_t) * (degree + 1));
+	Polynomial *p = bump(A, sizeof(Polynomial), ARENA_ALIGN);
+	p->degree = degree;
+	p->coefficients = bump(A, sizeof(coeff_t) * (degree + 1), ARENA_ALIGN);
+	for (int i = 0; i <= degree; i++) {
+		p->coefficients[i] = 0;
+	}
+	p->lc = 0;
+	p->lc_inv = 0;
+	return p;
+}
+
+Polynomial *arena_copy(Arena *A, Polynomial *poly)
+{
+	COUNT(polynomials, 1);
+	COUNT(bytes, sizeof(coeff_t) * (poly->degree + 1));
+	Polynomial *p = bump(A, sizeof(Polynomial), ARENA_ALIGN);
+	p->degree = poly->degree;
+	p->coefficients = bump(A, sizeof(coeff_t) * (poly->degree + 1),
+			ARENA_ALIGN);
+	for (int i = 0; i <= poly->degree; i++) {
+		p->coefficients[i] = poly->coefficients[i];
+	}
+	p->lc = poly->lc;
+	p->lc_inv = poly->lc_inv;
+	return p;
+}
+
+Matrix *arena_matrix(Arena *A, int rows, int cols)
+{
+	Matrix *M = bump(A, sizeof(Matrix), ARENA_ALIGN);
+	M->rows = rows;
+	M->cols = cols;
+
+	/* the same padded rows as init_matrix, so MATRIX_ROW works unchanged */
+	int block = MATRIX_ALIGN / sizeof(coeff_t);
+	M->stride = (cols + block - 1) / block * block;
+
+	size_t size = sizeof(coeff_t) * (size_t) rows * M->stride;
+	M->data = size ? bump(A, size, MATRIX_ALIGN) : NULL;
+	if (size) {
+		memset(M->data, 0, size);
+	}
+
+	return M;
+}
+
+/* --- utility functions -----------------------------------------------------*/
+
+/** Takes size bytes aligned to align, which divides MATRIX_ALIGN, from the
+ * current block, starting a new block if there is not enough room left */
+void *bump(Arena *A, size_t size, size_t align)
+{
+	ArenaBlock *B = A->blocks;
+	uintptr_t start;
+
+	if (B) {
+		start = ((uintptr_t) B->data + B->used + align - 1)
+			& ~(uintptr_t) (align - 1);
+		if (start + size <= (uintptr_t) B->data + B->size) {
+			B->used = start + size - (uintptr_t) B->data;
+			return (void *) start;
+		}
+	}
+
+	/* what is left of the old block is wasted, but only until a reset */
+	B = new_block(size > A->block_size ? size : A->block_size);
+	B->next = A->blocks;
+	A->blocks = B;
+	B->used = size;
+	return B->data;
+}
+
+/** Allocates a block with at least size bytes of data */
+ArenaBlock *new_block(size_t size)
+{
+	ArenaBlock *B = malloc(sizeof(ArenaBlock));
+	B->size = (size + MATRIX_ALIGN - 1) / MATRIX_ALIGN * MATRIX_ALIGN;
+	B->data = aligned_alloc(MATRIX_ALIGN, B->size);
+	B->used = 0;
+	B->next = NULL;
+	return B;
+}
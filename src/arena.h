@@ -0,0 +1,118 @@
+/**
+ * @file    arena.h
+ * @brief   A region allocator for the short lived polynomials and matrices made
+ *          while factorising.
+ *
+ * Memory is handed out from large blocks by moving an offset along, and is
+ * never given back piece by piece. Everything taken from an arena is released
+ * at once by reset_arena, which keeps the blocks for reuse, so once an arena
+ * has grown large enough for a factorisation, repeating it does no heap traffic
+ * at all.
+ *
+ * Polynomials and matrices taken from an arena must not be passed to
+ * free_polynomial or free_matrix. An arena is not locked, so each thread should
+ * use its own.
+ */
+
+#ifndef ARENA
+#define ARENA
+
+#include <stddef.h>
+#include "euclid.h"
+#include "matrix.h"
+
+/* Default number of bytes in each block of an arena */
+#define ARENA_BLOCK_SIZE (1 << 16)
+
+/* Alignment of every allocation, enough for any coefficient type */
+#define ARENA_ALIGN 16
+
+typedef struct arena_block {
+	unsigned char *data;      /* MATRIX_ALIGN aligned memory */
+	size_t size;              /* number of bytes in data */
+	size_t used;              /* number of bytes handed out so far */
+	struct arena_block *next; /* the block that was in use before this one */
+} ArenaBlock;
+
+typedef struct arena {
+	ArenaBlock *blocks;       /* the block being allocated from */
+	size_t block_size;        /* size of new blocks, unless asked for more */
+} Arena;
+
+/**
+ * Creates an empty arena. No memory is allocated for it until it is used.
+ *
+ * @param[in] block_size
+ *     the number of bytes in each block the arena takes from the heap, eg
+ *     ARENA_BLOCK_SIZE
+ * @return    a pointer to the new arena
+ */
+Arena *init_arena(size_t block_size);
+
+/**
+ * Frees an arena, and everything that was allocated from it.
+ *
+ * @param[in] A
+ *     the arena to be freed
+ */
+void free_arena(Arena *A);
+
+/**
+ * Releases everything allocated from an arena, keeping its memory for what is
+ * allocated next. If the arena had to grow past one block, its blocks are
+ * replaced by a single one as large as all of them together.
+ *
+ * @param[in] A
+ *     the arena to be reset
+ */
+void reset_arena(Arena *A);
+
+/**
+ * Allocates memory from an arena, aligned to ARENA_ALIGN bytes. The memory is
+ * not initialised.
+ *
+ * @param[in] A
+ *     the arena to allocate from
+ * @param[in] size
+ *     the number of bytes needed
+ * @return    a pointer to the memory, valid until the arena is reset or freed
+ */
+void *arena_alloc(Arena *A, size_t size);
+
+/**
+ * Allocates a polynomial from an arena, with all its coefficients set to zero.
+ *
+ * @param[in] A
+ *     the arena to allocate from
+ * @param[in] degree
+ *     the degree of the polynomial to be initialized
+ * @return    a pointer to the new polynomial
+ */
+Polynomial *arena_polynomial(Arena *A, int degree);
+
+/**
+ * Copies a polynomial into an arena.
+ *
+ * @param[in] A
+ *     the arena to allocate from
+ * @param[in] poly
+ *     the polynomial to be copied
+ * @return    a pointer to a copy of poly
+ */
+Polynomial *arena_copy(Arena *A, Polynomial *poly);
+
+/**
+ * Allocates a matrix from an arena, with all its entries set to zero and its
+ * rows laid out as by init_matrix.
+ *
+ * @param[in] A
+ *     the arena to allocate from
+ * @param[in] rows
+ *     the number of rows in the matrix
+ * @param[in] cols
+ *     the number of columns in the matrix
+ * @return    a pointer to the new matrix
+ */
+Matrix *arena_matrix(Arena *A, int rows, int cols);
+
+#endif
@@ -0,0 +1,275 @@
+/**
+ * @file    batch.c
+ * @brief   Factorises a stream of polynomials over finite fields on a pool of
+ *          worker threads, without prompting for any of them.
+ *
+ * Usage: batch [-c] [-j threads] [-o input|completion] [file]
+ *
+ * Records are read from file, or stdin if none is given. Each is a prime p, the
+ * degree of a polynomial over Z_p and then its coefficients from lowest order
+ * term to highest, all separated by whitespace, so the .txt files in
+ * test/berlekamp can be concatenated into a batch. For every record one line
+ * is written:
+ *
+ *     <record> <p> <number of factors> (<factor>)^<multiplicity> ...
+ *
+ * where records are numbered from 0 and the factors are the distinct monic
+ * irreducible factors found by full_factorisation. A record whose p is not a
+ * prime below 2^COEFF_MAX_BITS gives the line "<record> error <reason>"
+ * instead, and batch then exits with a failure once every record is done.
+ * Lines are written in input order by default, or as soon as each record is
+ * done with -o completion. With -c, the operations counted while factorising a
+ * record are appended to its line in square brackets, if counting was
+ * compiled in (see counters.h).
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "euclid.h"
+#include "berlekamp.h"
+#include "factorise.h"
+#include "pool.h"
+#include "primes.h"
+#include "counters.h"
+
+/* Number of records per worker that may be read ahead of the output. In input
+ * order, one slow record holds back the lines after it, and this is how far
+ * the other workers can get past it. */
+#define BATCH_WINDOW_PER_THREAD 8
+
+/* --- type definitions ------------------------------------------------------*/
+
+typedef struct batch {
+	FILE *out;
+	int in_order;             /* write lines in input order, not as finished */
+	int counts;               /* append the operation counts to each line */
+	int window;               /* most records read but not yet written */
+	int held;                 /* records read but not yet written */
+	long next;                /* the record whose line is to be written next */
+	char **lines;             /* finished lines waiting for earlier ones */
+	pthread_mutex_t lock;     /* guards everything above */
+	pthread_cond_t room;      /* signalled when held drops */
+} Batch;
+
+typedef struct record {
+	Batch *B;
+	long index;               /* position in the input, from 0 */
+	long long p;              /* as read, so that it can be checked */
+	Polynomial *poly;
+} Record;
+
+/* --- function prototypes ---------------------------------------------------*/
+
+int valid_modulus(long long p);
+void factor_record(void *arg);
+char *format_factors(long index, long long p, Polynomial *poly, int counts);
+void emit(Batch *B, long index, char *line);
+void usage(char *name);
+
+/* --- main routine ----------------------------------------------------------*/
+
+int main(int argc, char *argv[])
+{
+	int num_threads = 0, in_order = TRUE, counts = FALSE, opt;
+	while ((opt = getopt(argc, argv, "cj:o:")) != -1) {
+		if (opt == 'c') {
+			counts = TRUE;
+		} else if (opt == 'j' && atoi(optarg) > 0) {
+			num_threads = atoi(optarg);
+		} else if (opt == 'o' && strcmp(optarg, "input") == 0) {
+			in_order = TRUE;
+		} else if (opt == 'o' && strcmp(optarg, "completion") == 0) {
+			in_order = FALSE;
+		} else {
+			usage(argv[0]);
+		}
+	}
+	if (argc - optind > 1) {
+		usage(argv[0]);
+	}
+
+	FILE *in = stdin;
+	if (optind < argc && !(in = fopen(argv[optind], "r"))) {
+		perror(argv[optind]);
+		return EXIT_FAILURE;
+	}
+	if (counts && !counters_available()) {
+		fprintf(stderr, "%s: built without COUNT_OPERATIONS, counts will be "
+				"zero\n", argv[0]);
+	}
+	enable_counters(counts);
+
+	/* the workers take whole records, and share large ones between them */
+	Pool *P = init_pool(num_threads);
+	set_shared_pool(P);
+	Batch B;
+	B.out = stdout;
+	B.in_order = in_order;
+	B.counts = counts;
+	B.window = BATCH_WINDOW_PER_THREAD * P->num_threads;
+	B.held = 0;
+	B.next = 0;
+	B.lines = calloc(B.window, sizeof(char *));
+	pthread_mutex_init(&B.lock, NULL);
+	pthread_cond_init(&B.room, NULL);
+
+	/* read records until the input runs out, never holding more than the
+	 * window, and hand each one to the pool */
+	int status = EXIT_SUCCESS;
+	long index;
+	long long p;
+	Polynomial *poly;
+	Record *R;
+	for (index = 0; fscanf(in, "%lld", &p) == 1; index++) {
+		if (!(poly = read_polynomial(in))) {
+			fprintf(stderr, "record %ld: expected a degree and its "
+					"coefficients\n", index);
+			status = EXIT_FAILURE;
+			break;
+		}
+
+		pthread_mutex_lock(&B.lock);
+		while (B.held >= B.window) {
+			pthread_cond_wait(&B.room, &B.lock);
+		}
+		B.held++;
+		pthread_mutex_unlock(&B.lock);
+
+		/* the record still gets its error line, in its place */
+		if (!valid_modulus(p)) {
+			status = EXIT_FAILURE;
+		}
+
+		R = malloc(sizeof(Record));
+		R->B = &B;
+		R->index = index;
+		R->p = p;
+		R->poly = poly;
+		pool_submit(P, factor_record, R);
+	}
+	if (status == EXIT_SUCCESS && !feof(in)) {
+		fprintf(stderr, "record %ld: expected a prime\n", index);
+		status = EXIT_FAILURE;
+	}
+
+	free_pool(P);
+	set_shared_pool(NULL);
+	fflush(B.out);
+
+	pthread_cond_destroy(&B.room);
+	pthread_mutex_destroy(&B.lock);
+	free(B.lines);
+	if (in != stdin) {
+		fclose(in);
+	}
+
+	return status;
+}
+
+/* --- functions -------------------------------------------------------------*/
+
+/** Returns true if p is a prime that fits in a coeff_t. p is read wider than
+ * a coeff_t, so that one too large is caught here rather than wrapping. */
+int valid_modulus(long long p)
+{
+	return p >= 2 && p < 1LL << COEFF_MAX_BITS && is_prime((coeff_t) p);
+}
+
+/** Factorises the record passed as arg on a worker, and emits its line */
+void factor_record(void *arg)
+{
+	Record *R = arg;
+	char *line = format_factors(R->index, R->p, R->poly, R->B->counts);
+	emit(R->B, R->index, line);
+	free_polynomial(R->poly);
+	free(R);
+}
+
+/** Returns the output line for a record, without a newline, in a buffer which
+ * should be freed by the caller, with the operations counted appended if
+ * counts is set */
+char *format_factors(long index, long long p, Polynomial *poly, int counts)
+{
+	char *line;
+	size_t size;
+	FILE *stream = open_memstream(&line, &size);
+
+	if (!valid_modulus(p)) {
+		fprintf(stream, "%ld error modulus %lld is not a prime below 2^%d",
+				index, p, COEFF_MAX_BITS);
+		fclose(stream);
+		return line;
+	}
+
+	Field *F = init_field((coeff_t) p);
+	for (int i = 0; i <= poly->degree; i++) {
+		poly->coefficients[i] = field_elem(F, poly->coefficients[i]);
+	}
+
+	/* the counts of a worker cover the records it did before, so only what
+	 * this one adds is reported */
+	Counters before, after, used;
+	get_counters(&before);
+	int num_factors, *multiplicities;
+	Polynomial **factors = full_factorisation(&num_factors, &multiplicities,
+			poly, F);
+	get_counters(&after);
+	sub_counters(&used, &after, &before);
+
+	fprintf(stream, "%ld %lld %d", index, p, num_factors);
+	for (int i = 0; i < num_factors; i++) {
+		fprintf(stream, " (");
+		fprint_polynomial(stream, factors[i]);
+		fprintf(stream, ")^%d", multiplicities[i]);
+	}
+	if (counts) {
+		fprintf(stream, " [");
+		print_counters(stream, &used);
+		fprintf(stream, "]");
+	}
+	fclose(stream);
+
+	free_polynomials(factors, num_factors);
+	free(multiplicities);
+	free_field(F);
+
+	return line;
+}
+
+/** Writes the line for a record, or keeps it until the lines of all the
+ * records before it have been written if output is in input order. Takes
+ * ownership of line. */
+void emit(Batch *B, long index, char *line)
+{
+	pthread_mutex_lock(&B->lock);
+
+	if (!B->in_order) {
+		fprintf(B->out, "%s\n", line);
+		free(line);
+		B->held--;
+	} else {
+		/* index is within the window of next, since next is held */
+		B->lines[index % B->window] = line;
+		while ((line = B->lines[B->next % B->window])) {
+			fprintf(B->out, "%s\n", line);
+			free(line);
+			B->lines[B->next % B->window] = NULL;
+			B->next++;
+			B->held--;
+		}
+	}
+
+	pthread_cond_signal(&B->room);
+	pthread_mutex_unlock(&B->lock);
+}
+
+/** Prints how the program should be run, and exits */
+void usage(char *name)
+{
+	fprintf(stderr, "Usage: %s [-c] [-j threads] [-o input|completion] "
+			"[file]\n", name);
+	exit(EXIT_FAILURE);
+}
@@ -0,0 +1,496 @@
+/**
+ * @file    bench.c
+ * @brief   Times each stage of factorising random polynomials, for spotting
+ *          regressions and tuning the thresholds between algorithms.
+ *
+ * Usage: bench [-s seed] [-r reps] [-f csv|json] [-j threads]
+ *              [-c p,degree,factors,factor_degree,square_free] ...
+ *
+ * Each case is a random polynomial of the given degree over Z_p, made from the
+ * given number of random monic factors of factor_degree and one more random
+ * factor making up the rest of the degree. If square_free is 0, the first
+ * factor is squared; otherwise every factor is square free and coprime to the
+ * others. Without -c a built in suite is run. The same seed always gives the
+ * same polynomials.
+ *
+ * Every stage of the case is run reps times, and its fastest and median times
+ * are written as one CSV row or JSON object per stage. Hensel lifting and the
+ * CRT take microseconds, so they are timed over BENCH_CALLS calls and reported
+ * per call. Berlekamp's split gcds are only timed where factorise would pick
+ * Berlekamp, as for large p they would try every element of Z_p. With -j the
+ * shared pool is set to that many workers, otherwise everything runs on one
+ * thread.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "euclid.h"
+#include "matrix.h"
+#include "berlekamp.h"
+#include "cantor.h"
+#include "factorise.h"
+#include "lift.h"
+#include "pool.h"
+
+/* Default seed and number of runs of each stage */
+#define BENCH_SEED 1
+#define BENCH_REPS 5
+
+/* Number of calls of the stages too quick to time one call of */
+#define BENCH_CALLS 1000
+
+/* Most draws of a factor for a square free case, as Z_p may not have enough
+ * coprime polynomials of a small degree */
+#define BENCH_ATTEMPTS 1000
+
+/* Most stages of a case */
+#define BENCH_MAX_STAGES 12
+
+/* --- type definitions ------------------------------------------------------*/
+
+typedef struct bench_case {
+	coeff_t p;
+	int degree;
+	int factors;              /* random factors of factor_degree */
+	int factor_degree;
+	int square_free;          /* false if the first factor is squared */
+} BenchCase;
+
+typedef struct stage {
+	const char *name;
+	double *times;            /* seconds per call, for each run */
+} Stage;
+
+/* --- function prototypes ---------------------------------------------------*/
+
+void run_case(BenchCase *C, int index, int reps, unsigned long long seed,
+		int json, int *first);
+Polynomial *generate(BenchCase *C, unsigned long long *state, Field *F);
+Polynomial *random_monic(int degree, unsigned long long *state, Field *F);
+int is_square_free(Polynomial *f, Field *F);
+double time_hensel(Polynomial *f, Field *F);
+double time_crt(unsigned long long *state);
+Stage *stage(Stage *stages, int *num_stages, const char *name, int reps);
+void print_stage(BenchCase *C, int index, Stage *S, int reps, int json,
+		int *first);
+int compare_doubles(const void *a, const void *b);
+double now(void);
+coeff_t random_coeff(unsigned long long *state, coeff_t p);
+int parse_case(BenchCase *C, char *spec);
+void usage(char *name);
+
+/* --- main routine ----------------------------------------------------------*/
+
+int main(int argc, char *argv[])
+{
+	static BenchCase suite[] = {
+		{ 2, 256, 8, 16, 1 },
+		{ 2, 1024, 32, 16, 1 },
+		{ 3, 64, 4, 8, 1 },
+		{ 3, 256, 16, 8, 0 },
+		{ 101, 64, 4, 8, 1 },
+		{ 101, 128, 8, 8, 0 },
+		{ 65537, 64, 4, 8, 1 },
+		{ 65537, 256, 8, 16, 1 }
+	};
+	int num_cases = sizeof(suite) / sizeof(BenchCase);
+
+	BenchCase *cases = malloc(sizeof(BenchCase) * argc);
+	int num_given = 0, num_threads = 0, json = FALSE, opt;
+	int reps = BENCH_REPS;
+	unsigned long long seed = BENCH_SEED;
+	while ((opt = getopt(argc, argv, "s:r:f:j:c:")) != -1) {
+		if (opt == 's') {
+			seed = strtoull(optarg, NULL, 10);
+		} else if (opt == 'r' && atoi(optarg) > 0) {
+			reps = atoi(optarg);
+		} else if (opt == 'f' && strcmp(optarg, "csv") == 0) {
+			json = FALSE;
+		} else if (opt == 'f' && strcmp(optarg, "json") == 0) {
+			json = TRUE;
+		} else if (opt == 'j' && atoi(optarg) > 0) {
+			num_threads = atoi(optarg);
+		} else if (opt == 'c' && parse_case(cases + num_given, optarg)) {
+			num_given++;
+		} else {
+			usage(argv[0]);
+		}
+	}
+	if (optind < argc) {
+		usage(argv[0]);
+	}
+	if (num_given > 0) {
+		num_cases = num_given;
+	} else {
+		free(cases);
+		cases = suite;
+	}
+
+	Pool *P = num_threads > 0 ? init_pool(num_threads) : NULL;
+	set_shared_pool(P);
+
+	int first = TRUE;
+	if (json) {
+		printf("[");
+	} else {
+		printf("case,p,degree,factors,factor_degree,square_free,stage,reps,"
+				"min_ns,median_ns\n");
+	}
+	for (int i = 0; i < num_cases; i++) {
+		run_case(cases + i, i, reps, seed + i, json, &first);
+	}
+	if (json) {
+		printf("\n]\n");
+	}
+
+	set_shared_pool(NULL);
+	if (P) {
+		free_pool(P);
+	}
+	if (cases != suite) {
+		free(cases);
+	}
+
+	return EXIT_SUCCESS;
+}
+
+/* --- functions -------------------------------------------------------------*/
+
+/** Times every stage of a case, and prints a row for each of them */
+void run_case(BenchCase *C, int index, int reps, unsigned long long seed,
+		int json, int *first)
+{
+	Field *F = init_field(C->p);
+	unsigned long long state = seed ? seed : BENCH_SEED;
+	Polynomial *f = generate(C, &state, F);
+	if (!f) {
+		fprintf(stderr, "case %d: no square free polynomial found\n", index);
+		free_field(F);
+		return;
+	}
+
+	/* Berlekamp and Cantor-Zassenhaus need a square free input, so they are
+	 * given the product of the square free parts */
+	int num_parts, *exponents, count, rank;
+	Polynomial **square_free_parts = square_free(&num_parts, &exponents, f, F);
+	Polynomial *g = init_polynomial(0), *helper;
+	g->coefficients[0] = 1;
+	for (int i = 0; i < num_parts; i++) {
+		helper = poly_mul(g, square_free_parts[i], F);
+		free_polynomial(g);
+		g = helper;
+	}
+	free_polynomials(square_free_parts, num_parts);
+	free(exponents);
+	int split = F->p <= (coeff_t) BERLEKAMP_MAX_PRIME_PER_DEGREE * g->degree;
+
+	Stage stages[BENCH_MAX_STAGES];
+	int num_stages = 0;
+	Stage *matrix = stage(stages, &num_stages, "matrix", reps);
+	Stage *transposing = stage(stages, &num_stages, "transpose", reps);
+	Stage *gauss = stage(stages, &num_stages, "gauss_jordan", reps);
+	Stage *kernel = stage(stages, &num_stages, "null_space", reps);
+	Stage *gcds = split ? stage(stages, &num_stages, "split", reps) : NULL;
+	Stage *whole = split ? stage(stages, &num_stages, "berlekamp", reps) : NULL;
+	Stage *cz = stage(stages, &num_stages, "cantor_zassenhaus", reps);
+	Stage *parts = stage(stages, &num_stages, "square_free", reps);
+	Stage *full = stage(stages, &num_stages, "full_factorisation", reps);
+	Stage *lifting = stage(stages, &num_stages, "hensel", reps);
+	Stage *crt = stage(stages, &num_stages, "crt", reps);
+
+	Matrix *M, *K;
+	Polynomial **subalgebra, **facs;
+	double start;
+	for (int r = 0; r < reps; r++) {
+		start = now();
+		M = get_berlekamp_matrix(g, F);
+		matrix->times[r] = now() - start;
+
+		start = now();
+		transpose(M);
+		transposing->times[r] = now() - start;
+
+		subtract_identity(M, F);
+		start = now();
+		gauss_jordan(M, F);
+		gauss->times[r] = now() - start;
+
+		start = now();
+		K = null_space(&rank, M, F);
+		kernel->times[r] = now() - start;
+
+		if (gcds) {
+			subalgebra = kernel_to_arr(K);
+			start = now();
+			facs = factors(g, subalgebra, g->degree - rank, F);
+			gcds->times[r] = now() - start;
+			if (facs) {
+				free_polynomials(facs, g->degree - rank);
+			}
+			free_polynomials(subalgebra, g->degree - rank);
+
+			start = now();
+			facs = berlekamp(&count, g, F);
+			whole->times[r] = now() - start;
+			free_polynomials(facs, count);
+		}
+		free_matrix(K);
+		free_matrix(M);
+
+		start = now();
+		facs = cantor_zassenhaus(&count, g, F);
+		cz->times[r] = now() - start;
+		free_polynomials(facs, count);
+
+		start = now();
+		facs = square_free(&count, &exponents, f, F);
+		parts->times[r] = now() - start;
+		free_polynomials(facs, count);
+		free(exponents);
+
+		start = now();
+		facs = full_factorisation(&count, &exponents, f, F);
+		full->times[r] = now() - start;
+		free_polynomials(facs, count);
+		free(exponents);
+
+		lifting->times[r] = time_hensel(f, F);
+		crt->times[r] = time_crt(&state);
+	}
+
+	for (int i = 0; i < num_stages; i++) {
+		print_stage(C, index, stages + i, reps, json, first);
+		free(stages[i].times);
+	}
+
+	free_polynomial(g);
+	free_polynomial(f);
+	free_field(F);
+}
+
+/** Returns a random polynomial for a case, as described at the top of this
+ * file. For square free cases each factor is drawn again until it is square
+ * free and coprime to those before it, and NULL is returned if that fails. */
+Polynomial *generate(BenchCase *C, unsigned long long *state, Field *F)
+{
+	Polynomial *f = init_polynomial(0), *factor, *helper, *g;
+	f->coefficients[0] = 1;
+	int coprime;
+	int repeated = C->square_free ? 0 : C->factor_degree;
+	int rest = C->degree - C->factors * C->factor_degree - repeated;
+
+	for (int i = 0; i <= C->factors; i++) {
+		if (i == C->factors && rest == 0) {
+			break;
+		}
+		factor = random_monic(i < C->factors ? C->factor_degree : rest, state,
+				F);
+		for (int j = 0; C->square_free; j++) {
+			g = gcd_p(f, factor, F);
+			coprime = normalize_p(g, F) == 0;
+			free_polynomial(g);
+			if (coprime && is_square_free(factor, F)) {
+				break;
+			}
+			free_polynomial(factor);
+			if (j == BENCH_ATTEMPTS) {
+				free_polynomial(f);
+				return NULL;
+			}
+			factor = random_monic(i < C->factors ? C->factor_degree : rest,
+					state, F);
+		}
+
+		helper = poly_mul(f, factor, F);
+		free_polynomial(f);
+		f = helper;
+		if (i == 0 && repeated) {
+			helper = poly_mul(f, factor, F);
+			free_polynomial(f);
+			f = helper;
+		}
+		free_polynomial(factor);
+	}
+
+	normalize_p(f, F);
+	return f;
+}
+
+/** Returns a random monic polynomial of the given degree */
+Polynomial *random_monic(int degree, unsigned long long *state, Field *F)
+{
+	Polynomial *f = init_polynomial(degree);
+	for (int i = 0; i < degree; i++) {
+		f->coefficients[i] = random_coeff(state, F->p);
+	}
+	f->coefficients[degree] = 1;
+	return f;
+}
+
+/** Returns true if gcd(f, f') is constant */
+int is_square_free(Polynomial *f, Field *F)
+{
+	Polynomial *d = get_formal_derivative(f, F);
+	Polynomial *g = gcd_p(f, d, F);
+	int result = normalize_p(g, F) == 0 && g->lc != 0;
+	free_polynomial(g);
+	free_polynomial(d);
+	return result;
+}
+
+/** Returns the time per call of lifting 0 to a root mod the largest power of p
+ * that fits, for f with its constant term dropped, which makes 0 a root, and
+ * its linear term made non-zero if need be, which makes it simple */
+double time_hensel(Polynomial *f, Field *F)
+{
+	Polynomial *g = copy_polynomial(f);
+	g->coefficients[0] = 0;
+	if (g->degree < 1) {
+		free_polynomial(g);
+		return 0;
+	}
+	if (field_elem(F, g->coefficients[1]) == 0) {
+		g->coefficients[1] = 1;
+	}
+
+	int k = 1;
+	for (dcoeff_t q = F->p; q * F->p < ((dcoeff_t) 1 << (COEFF_MAX_BITS - 1));
+			q *= F->p) {
+		k++;
+	}
+
+	coeff_t power;
+	volatile coeff_t sink = 0;
+	double start = now();
+	for (int i = 0; i < BENCH_CALLS; i++) {
+		sink += hensel(&power, g, 0, F, k);
+	}
+	double elapsed = now() - start;
+	(void) sink;
+
+	free_polynomial(g);
+	return elapsed / BENCH_CALLS;
+}
+
+/** Returns the time per call of solving a system of congruences mod the first
+ * few primes, as many as the product of the moduli has room for */
+double time_crt(unsigned long long *state)
+{
+	coeff_t divisors[COEFF_MAX_BITS], remainders[COEFF_MAX_BITS];
+	int n = 0;
+	dcoeff_t product = 1;
+	for (coeff_t q = 2; n < COEFF_MAX_BITS; q++) {
+		int prime = TRUE;
+		for (coeff_t d = 2; d * d <= q && prime; d++) {
+			prime = q % d != 0;
+		}
+		if (!prime) {
+			continue;
+		}
+		if (product * q >= ((dcoeff_t) 1 << (COEFF_MAX_BITS - 1))) {
+			break;
+		}
+		product *= q;
+		divisors[n] = q;
+		remainders[n] = random_coeff(state, q);
+		n++;
+	}
+
+	coeff_t helper;
+	volatile coeff_t sink = 0;
+	double start = now();
+	for (int i = 0; i < BENCH_CALLS; i++) {
+		sink += chinese_remainder(&helper, n, remainders, divisors);
+	}
+	double elapsed = now() - start;
+	(void) sink;
+
+	return elapsed / BENCH_CALLS;
+}
+
+/** Adds a stage with room for the times of reps runs, and returns it */
+Stage *stage(Stage *stages, int *num_stages, const char *name, int reps)
+{
+	Stage *S = stages + (*num_stages)++;
+	S->name = name;
+	S->times = malloc(sizeof(double) * reps);
+	return S;
+}
+
+/** Prints the fastest and median times of a stage, as a CSV row or a JSON
+ * object */
+void print_stage(BenchCase *C, int index, Stage *S, int reps, int json,
+		int *first)
+{
+	qsort(S->times, reps, sizeof(double), compare_doubles);
+	double min = S->times[0] * 1e9;
+	double median = (reps % 2 ? S->times[reps / 2]
+			: (S->times[reps / 2 - 1] + S->times[reps / 2]) / 2) * 1e9;
+
+	if (json) {
+		printf("%s\n  {\"case\": %d, \"p\": " COEFF_FMT ", \"degree\": %d, "
+				"\"factors\": %d, \"factor_degree\": %d, "
+				"\"square_free\": %s, \"stage\": \"%s\", \"reps\": %d, "
+				"\"min_ns\": %.0f, \"median_ns\": %.0f}", *first ? "" : ",",
+				index, C->p, C->degree, C->factors, C->factor_degree,
+				C->square_free ? "true" : "false", S->name, reps, min,
+				median);
+	} else {
+		printf("%d," COEFF_FMT ",%d,%d,%d,%d,%s,%d,%.0f,%.0f\n", index, C->p,
+				C->degree, C->factors, C->factor_degree, C->square_free,
+				S->name, reps, min, median);
+	}
+	*first = FALSE;
+}
+
+/** Orders doubles from smallest to largest, for qsort */
+int compare_doubles(const void *a, const void *b)
+{
+	double x = *(const double *) a, y = *(const double *) b;
+	return (x > y) - (x < y);
+}
+
+/** Returns the time in seconds from a fixed point, for measuring intervals */
+double now(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/** Returns a pseudorandom element of Z_p, from a xorshift generator */
+coeff_t random_coeff(unsigned long long *state, coeff_t p)
+{
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+	unsigned long long x = *state * 0x2545F4914F6CDD1DULL;
+	return (coeff_t) (x % (unsigned long long) p);
+}
+
+/** Reads a case given as p,degree,factors,factor_degree,square_free, and
+ * returns whether it is a valid one */
+int parse_case(BenchCase *C, char *spec)
+{
+	long long p;
+	int n = sscanf(spec, "%lld,%d,%d,%d,%d", &p, &C->degree, &C->factors,
+			&C->factor_degree, &C->square_free);
+	C->p = (coeff_t) p;
+	return n == 5 && p >= 2 && (dcoeff_t) p < (dcoeff_t) 1 << COEFF_MAX_BITS
+		&& C->degree >= 1 && C->factor_degree >= 1
+		&& C->factors >= (C->square_free ? 0 : 1)
+		&& (C->factors + !C->square_free) * C->factor_degree <= C->degree;
+}
+
+/** Prints how the program should be run, and exits */
+void usage(char *name)
+{
+	fprintf(stderr, "Usage: %s [-s seed] [-r reps] [-f csv|json] "
+			"[-j threads]\n"
+			"       [-c p,degree,factors,factor_degree,square_free] ...\n",
+			name);
+	exit(EXIT_FAILURE);
+}
@@ -6,88 +6,130 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include "arena.h"
 #include "euclid.h"
+#include "matrix.h"
 #include "berlekamp.h"
+#include "gf2.h"
+#include "pool.h"
+
+/* What the last call of berlekamp_in on each thread did */
+static _Thread_local Counters last_counts;
+
+/* Rows of the Berlekamp matrix, built in chunks which each start from a power
+ * of x^m of their own, so they can be built on different threads */
+typedef struct matrix_rows {
+	Matrix *matrix;
+	Polynomial *p;            /* the polynomial whose matrix this is */
+	Polynomial *frobenius;    /* x^m mod p */
+	int chunks;               /* the number of chunks the rows are cut into */
+	int transposed;           /* write each power to a column instead */
+	Field *F;
+} MatrixRows;
+
+/* A round of consecutive gcds gcd(f, v - s), gcd(f, v - s - 1), ..., which are
+ * independent and so can be found on different threads. Each thread changes
+ * the constant term of its own copy of v, and has its own scratch space. */
+typedef struct gcd_round {
+	Polynomial *f;
+	Polynomial *v;
+	coeff_t c;                /* the constant term of v, reduced */
+	coeff_t s;                /* the first s of the round */
+	int width;                /* the most gcds in a round */
+	Polynomial **gcds;        /* gcds[i] = gcd(f, v - s - i), not monic */
+	Polynomial **vs;          /* a copy of v for each thread */
+	coeff_t **work;           /* scratch space for gcd_p_into for each thread */
+	Pool *pool;               /* the pool the round runs on, or NULL */
+	Field *F;
+} GcdRound;
 
 /* --- function prototypes ---------------------------------------------------*/
 
 int is_constant(Polynomial *p);
+static coeff_t leading_coefficient(Polynomial *p);
+static int actual_degree(Polynomial *p);
+static void refine(Polynomial **facs, int *counter, int max, Polynomial *v,
+		Arena *A, Field *F);
+static Polynomial **factor_square_free(int *num_factors, Polynomial *poly,
+		Arena *A, Field *F);
+static void fill_berlekamp_matrix(Matrix *matrix, Polynomial *p, Field *F,
+		int transposed);
+static void fill_rows(void *arg, int chunk, int worker);
+static void init_round(GcdRound *R, Polynomial *v, int degree, Arena *A,
+		Field *F);
+static int run_round(GcdRound *R, Polynomial *f, coeff_t s);
+static void round_gcd(void *arg, int i, int worker);
 
 /* --- berlekamp interface ---------------------------------------------------*/
 
-int **get_berlekamp_matrix(Polynomial *p, int m)
+Matrix *get_berlekamp_matrix(Polynomial *p, Field *F)
 {
-	/* initialize helper polynomial and matrix */
-	int degree = p->degree;
-	Polynomial *helper = init_polynomial(m * degree);
-	int **matrix;
-	matrix = malloc(sizeof(int *) * degree);
-
-	/* compute powers x^(2i) mod p */
-	Polynomial *q, *r; /* quotient and remainder */
-	for (int i = 0; i < degree; i++) {
-		if (i != 0) {
-			helper->coefficients[m*(i - 1)] = 0;
-		}
-		helper->coefficients[m*i] = 1;
-
-		long_div(&q, &r, helper, p, m);
-		matrix[i] = r->coefficients;
-
-		free_polynomial(q);
-		free(r);
-	}
-
-	free_polynomial(helper);
+	Matrix *matrix = init_matrix(p->degree, p->degree);
+	fill_berlekamp_matrix(matrix, p, F, FALSE);
+	return matrix;
+}
 
+Matrix *get_berlekamp_transpose(Polynomial *p, Field *F)
+{
+	Matrix *matrix = init_matrix(p->degree, p->degree);
+	fill_berlekamp_matrix(matrix, p, F, TRUE);
 	return matrix;
 }
 
-void transpose(int ***A, int m, int n)
+void transpose(Matrix *A)
 {
-	/* initialize a new matrix which will replace A */
-	int **B = malloc(sizeof(int *) * n);
-	for (int i = 0; i < n; i++) {
-		B[i] = malloc(sizeof(int) * m);
+	coeff_t helper;
+
+	/* square matrices are transposed by swapping entries across the diagonal */
+	if (A->rows == A->cols) {
+		for (int i = 0; i < A->rows; i++) {
+			for (int j = i + 1; j < A->cols; j++) {
+				helper = MATRIX_ROW(A, i)[j];
+				MATRIX_ROW(A, i)[j] = MATRIX_ROW(A, j)[i];
+				MATRIX_ROW(A, j)[i] = helper;
+			}
+		}
+		return;
 	}
 
-	/* copy values from A into B */
-	for (int i = 0; i < m; i++) {
-		for (int j = 0; j < n; j++) {
-			B[j][i] = (*A)[i][j];
+	/* otherwise the shape changes, so move the entries to a new block */
+	Matrix *B = init_matrix(A->cols, A->rows);
+	for (int i = 0; i < A->rows; i++) {
+		for (int j = 0; j < A->cols; j++) {
+			MATRIX_ROW(B, j)[i] = MATRIX_ROW(A, i)[j];
 		}
 	}
-
-	/* free old matrix and assign B to *A */
-	free_matrix(*A, m);
-
-	*A = B;
+	free(A->data);
+	*A = *B;
+	free(B);
 }
 
-void subtract_identity(int **A, int m, int n, int p)
+void subtract_identity(Matrix *A, Field *F)
 {
 	/* Check A is square */
-	if (m != n) {
+	if (A->rows != A->cols) {
 		printf("ERROR: Cannot subtract identity, A is not square");
 		return;
 	}
 
 	/* Subtract I from A */
-	for (int i = 0; i < m; i++) {
-		A[i][i] = mod(A[i][i] - 1, p);
+	for (int i = 0; i < A->rows; i++) {
+		MATRIX_ROW(A, i)[i] = field_sub(F, MATRIX_ROW(A, i)[i], 1);
 	}
 }
 
-void gauss_jordan(int **A, int m, int n, int p)
+void gauss_jordan(Matrix *A, Field *F)
 {
 	/* Initialize and declare variables */
+	int m = A->rows, n = A->cols;
 	int lead = 0;
-	int i, j, s, t, factor, *helper;
+	int i;
+	coeff_t inv, *row_r, *row_i;
 
 	for (int r = 0; r < m && lead < n; r++) {
 		/* Find row with pivot element in 'lead' column */
 		i = r;
-		while (A[i][lead] % p == 0) {
+		while (MATRIX_ROW(A, i)[lead] == 0) {
 			i++;
 			/* If we have exhausted rows, increment lead and start over */
 			if (i == m) {
@@ -101,24 +143,23 @@ void gauss_jordan(int **A, int m, int n, int p)
 
 		/* Swap rows i and r */
 		if (i != r) {
-			helper = A[i];
-			A[i] = A[r];
-			A[r] = helper;
+			swap_rows(A, i, r);
 		}
 
 		/* Multiply row r by inverse of A[r][lead] */
-		extended_gcd_z(&s, &t, p, A[r][lead]);
+		row_r = MATRIX_ROW(A, r);
+		inv = field_inv(F, row_r[lead]);
 		for (i = lead; i < n; i++) {
-			A[r][i] = mod(A[r][i] * t, p);
+			row_r[i] = field_mul(F, row_r[i], inv);
 		}
 
-		/* Make sure col lead only has an element in row r */
+		/* Make sure col lead only has an element in row r. Row r is zero
+		 * before column lead, so only the rest of each row changes. */
 		for (i = 0; i < m; i++) {
-			if (i != r && A[i][lead] % p != 0) {
-				factor = A[i][lead];
-				for (j = 0; j < n; j++) {
-					A[i][j] = mod(A[i][j] - factor * A[r][j], p);
-				}
+			row_i = MATRIX_ROW(A, i);
+			if (i != r && row_i[lead] != 0) {
+				row_mul_add(row_i + lead, row_r + lead,
+						field_neg(F, row_i[lead]), n - lead, F);
 			}
 		}
 
@@ -126,9 +167,10 @@ void gauss_jordan(int **A, int m, int n, int p)
 	}
 }
 
-int **null_space(int *rank, int **R, int m, int n, int p)
+Matrix *null_space(int *rank, Matrix *R, Field *F)
 {
 	/* First store the pivot elements positions and count them to get the rank */
+	int m = R->rows, n = R->cols;
 	*rank = 0;
 	int col = 0, row = 0;
 	int *pivot = malloc(sizeof(int) * m);
@@ -136,7 +178,7 @@ int **null_space(int *rank, int **R, int m, int n, int p)
 		pivot[i] = -1; /* corresponds to no pivot in row */
 	}
 	while (row < m && col < n) {
-		if (R[row][col] != 0) {
+		if (MATRIX_ROW(R, row)[col] != 0) {
 			pivot[row] = col;
 			(*rank)++;
 			row++;
@@ -147,31 +189,27 @@ int **null_space(int *rank, int **R, int m, int n, int p)
 	}
 
 	/* Nullity is cols - rank */
-	int **kernel = malloc(sizeof(int *) * (n - *rank));
-	for (int i = 0; i < n - *rank; i++) {
-		kernel[i] = malloc(sizeof(int) * n);
-		for (int j = 0; j < n; j++) {
-			kernel[i][j] = 0;
-		}
-	}
+	Matrix *kernel = init_matrix(n - *rank, n);
 
 	/* Now we find the free variables and update the kernel */
 	int free_variables = 0;
+	coeff_t *vector;
 	col = 0;
 	row = -1;
 	while (row < m && col < n) {
-		if (row + 1 < m && R[row+1][col] != 0) {
+		if (row + 1 < m && MATRIX_ROW(R, row + 1)[col] != 0) {
 			/* Pivot element, so go to next row */
 			row++;
 			col++;
 		} else {
 			/* Free variable */
+			vector = MATRIX_ROW(kernel, free_variables);
 			for (int i = 0; i < m; i++) {
 				if (row >= 0 && pivot[i] != -1) {
-					kernel[free_variables][pivot[i]] = mod(-R[i][col], p);
+					vector[pivot[i]] = field_neg(F, MATRIX_ROW(R, i)[col]);
 				}
 			}
-			kernel[free_variables][col] = 1;
+			vector[col] = 1;
 			free_variables++;
 			col++;
 		}
@@ -182,21 +220,25 @@ int **null_space(int *rank, int **R, int m, int n, int p)
 	return kernel;
 }
 
-Polynomial **kernel_to_arr(int **kernel, int m, int n)
+Polynomial **kernel_to_arr(Matrix *kernel)
 {
+	int m = kernel->rows, n = kernel->cols;
 	Polynomial **arr = malloc(sizeof(Polynomial *) * m);
 	for (int i = 0; i < m; i++) {
 		arr[i] = malloc(sizeof(Polynomial));
 		arr[i]->degree = n - 1;
-		arr[i]->coefficients = malloc(sizeof(int) * n);
+		arr[i]->coefficients = malloc(sizeof(coeff_t) * n);
+		arr[i]->lc = 0;
+		arr[i]->lc_inv = 0;
 		for (int j = 0; j < n; j++) {
-			arr[i]->coefficients[j] = kernel[i][j];
+			arr[i]->coefficients[j] = MATRIX_ROW(kernel, i)[j];
 		}
 	}
 	return arr;
 }
 
-Polynomial **factors(Polynomial *p, Polynomial **subalgebra, int nullity, int m)
+Polynomial **factors(Polynomial *p, Polynomial **subalgebra, int nullity,
+		Field *F)
 {
 	/* p has nullity distinct factors */
 	Polynomial **facs = malloc(sizeof(Polynomial *) * nullity);
@@ -216,15 +258,52 @@ Polynomial **factors(Polynomial *p, Polynomial **subalgebra, int nullity, int m)
 		return NULL;
 	}
 
-	/* f(x) = product[s in F_q](gcd(p, g(x)-s), where F_q is field */
+	/* f(x) = product[s in F_q](gcd(p, g(x)-s), where F_q is field. Only the
+	 * non-trivial gcds are kept, and we stop once their degrees add up to p's.
+	 * The gcds are found a round at a time, possibly on several threads, but
+	 * are kept in order of s, so the factors do not depend on the threads */
+	Arena *A = init_arena(ARENA_BLOCK_SIZE);
+	GcdRound R;
+	init_round(&R, subalgebra[ip], p->degree, A, F);
 	Polynomial *factor;
-	for (int s = 0; s < nullity; s++) {
-		subalgebra[ip]->coefficients[0] -= s;
-		factor = gcd_p(p, subalgebra[ip], m);
-		subalgebra[ip]->coefficients[0] += s;
-		facs[counter] = factor;
-		counter++;
+	int remaining = actual_degree(p);
+	int count;
+	for (coeff_t s = 0; s < F->p && counter < nullity && remaining > 0;
+			s += count) {
+		count = run_round(&R, p, s);
+		for (int i = 0; i < count && counter < nullity && remaining > 0;
+				i++) {
+			factor = R.gcds[i];
+			if (factor->degree == 0) {
+				continue;
+			}
+			remaining -= factor->degree;
+			facs[counter] = copy_polynomial(factor);
+			counter++;
+		}
+	}
+	free_arena(A);
+
+	/* one element of the subalgebra need not separate every factor, so pad
+	 * with trivial factors, which berlekamp skips */
+	for (; counter < nullity; counter++) {
+		facs[counter] = init_polynomial(0);
+		facs[counter]->coefficients[0] = 1;
+	}
+
+	/* Make the factors monic, with one inversion shared between all of them */
+	coeff_t *lcs = malloc(sizeof(coeff_t) * counter);
+	for (int i = 0; i < counter; i++) {
+		lcs[i] = leading_coefficient(facs[i]);
+	}
+	field_batch_inv(F, lcs, lcs, counter);
+	for (int i = 0; i < counter; i++) {
+		for (int j = 0; j <= facs[i]->degree; j++) {
+			facs[i]->coefficients[j] = field_mul(F, facs[i]->coefficients[j],
+					lcs[i]);
+		}
 	}
+	free(lcs);
 
 	/* Return what we found and worry about discarding/reducing factors later */
 	return facs;
@@ -238,33 +317,56 @@ void free_polynomials(Polynomial **polynomials, int nullity)
 	free(polynomials);
 }
 
-void free_matrix(int **matrix, int m)
+Polynomial **berlekamp(int *num_factors, Polynomial *poly, Field *F)
 {
-	for (int i = 0; i < m; i++) {
-		free(matrix[i]);
-	}
-	if (matrix) {
-		free(matrix);
-	}
+	Arena *A = init_arena(ARENA_BLOCK_SIZE);
+	Polynomial **facs = berlekamp_in(num_factors, poly, A, F);
+	free_arena(A);
+	return facs;
+}
+
+Polynomial **berlekamp_in(int *num_factors, Polynomial *poly, Arena *A,
+		Field *F)
+{
+	Counters before, after;
+	get_counters(&before);
+	Polynomial **facs = factor_square_free(num_factors, poly, A, F);
+	get_counters(&after);
+	sub_counters(&last_counts, &after, &before);
+	return facs;
+}
+
+void berlekamp_counters(Counters *c)
+{
+	*c = last_counts;
 }
 
-Polynomial **berlekamp(int *num_factors, Polynomial *poly, int m)
+/* --- utility functions -----------------------------------------------------*/
+
+/** Factorises a square free polynomial as described for berlekamp_in */
+Polynomial **factor_square_free(int *num_factors, Polynomial *poly, Arena *A,
+		Field *F)
 {
-	/* Get Berlekamp subalgebra */
-	int **matrix = get_berlekamp_matrix(poly, m);
-	subtract_identity(matrix, poly->degree, poly->degree, m);
-	transpose(&matrix, poly->degree, poly->degree);
-	gauss_jordan(matrix, poly->degree, poly->degree, m);
+	/* Z_2 has its own bit packed engine */
+	if (F->p == 2) {
+		return gf2_berlekamp(num_factors, poly);
+	}
 
-	int **kernel, rank;
-	kernel = null_space(&rank, matrix, poly->degree, poly->degree, m);
+	/* Get Berlekamp subalgebra, building B - I already transposed */
+	Matrix *matrix = arena_matrix(A, poly->degree, poly->degree);
+	fill_berlekamp_matrix(matrix, poly, F, TRUE);
+	subtract_identity(matrix, F);
+	gauss_jordan(matrix, F);
+
+	Matrix *kernel;
+	int rank;
+	kernel = null_space(&rank, matrix, F);
 
 	*num_factors = poly->degree - rank;
 
 	if (*num_factors == 0 || *num_factors == 1) {
 		/* free memory allocated so far */
-		free_matrix(matrix, poly->degree);
-		free_matrix(kernel, *num_factors);
+		free_matrix(kernel);
 		/* polynomial is irreducible */
 		*num_factors = 1;
 		Polynomial **facs = malloc(sizeof(Polynomial *));
@@ -272,51 +374,40 @@ Polynomial **berlekamp(int *num_factors, Polynomial *poly, int m)
 		return facs;
 	}
 
-	Polynomial **subalgebra = kernel_to_arr(kernel, poly->degree - rank, poly->degree);
-
-	/* Now, find factors of poly and recursively call berlekamp on them until we
-	 * are left with irreducible polynomial factors */
-	Polynomial **check = factors(poly, subalgebra, poly->degree - rank, m);
-	if (!check) {
-		/* No non-trivial factors */
-		/* TODO not sure if this will ever be executed */
-		*num_factors = 1;
-		Polynomial **facs = malloc(sizeof(Polynomial *));
-		*facs = copy_polynomial(poly);
-		return facs;
+	/* the rows of the kernel are used as polynomials where they are */
+	int nullity = *num_factors;
+	Polynomial *subalgebra = arena_alloc(A, sizeof(Polynomial) * nullity);
+	for (int i = 0; i < nullity; i++) {
+		subalgebra[i].degree = kernel->cols - 1;
+		subalgebra[i].coefficients = MATRIX_ROW(kernel, i);
+		subalgebra[i].lc = 0;
+		subalgebra[i].lc_inv = 0;
 	}
 
-	Polynomial **facs = malloc(sizeof(Polynomial *) * (poly->degree - rank));
-	Polynomial **reduced_facs; /* use to store factors of factors */
-	int counter, helper;
-	counter = 0;
-
-	/* iterate over factors, discard trivial ones, reduce reducible ones */
-	for (int i = 0; i < poly->degree - rank; i++) {
-		if (!is_constant(check[i])) {
-			reduced_facs = berlekamp(&helper, check[i], m);
-			for (int j = 0; j < helper; j++) {
-				facs[counter++] = reduced_facs[j];
-			}
-			free(reduced_facs);
+	/* Split with one element of the subalgebra after another, until there are
+	 * as many factors as the nullity. Together they separate every pair of
+	 * irreducible factors, so no matrix needs to be built again */
+	Polynomial **parts = arena_alloc(A, sizeof(Polynomial *) * nullity);
+	parts[0] = arena_polynomial(A, poly->degree);
+	monic_p_into(parts[0], poly, F);
+	int counter = 1;
+	for (int i = 0; i < nullity && counter < nullity; i++) {
+		if (!is_constant(&subalgebra[i])) {
+			refine(parts, &counter, nullity, &subalgebra[i], A, F);
 		}
 	}
-
-	/* FIXME num_factors should already be correct ...  this is just to try fix
-	 * poly6 */
 	*num_factors = counter;
 
-	/* Free allocated memory */
-	free_matrix(matrix, poly->degree);
-	free_matrix(kernel, poly->degree - rank);
-	free_polynomials(subalgebra, poly->degree - rank);
-	free_polynomials(check, poly->degree - rank);
+	/* only the factors themselves outlive the arena */
+	Polynomial **facs = malloc(sizeof(Polynomial *) * counter);
+	for (int i = 0; i < counter; i++) {
+		facs[i] = copy_polynomial(parts[i]);
+	}
+	free_matrix(kernel);
 
 	return facs;
 }
 
-/* --- utility functions -----------------------------------------------------*/
-
 /** Return true if polynomial is a constant */
 int is_constant(Polynomial *p)
 {
@@ -328,3 +419,197 @@ int is_constant(Polynomial *p)
 	}
 	return trivial;
 }
+
+/** Fills in the Berlekamp matrix of p, whose row i is x^(m*i) mod p. If
+ * transposed is true, each power is written to a column instead. The matrix
+ * should be degree * degree, and start out zero. */
+void fill_berlekamp_matrix(Matrix *matrix, Polynomial *p, Field *F,
+		int transposed)
+{
+	int degree = p->degree;
+	if (degree == 0) {
+		return;
+	}
+	COUNT(matrices, 1);
+
+	/* compute x^m mod p by repeated squaring */
+	Polynomial *x = init_polynomial(1);
+	x->coefficients[1] = 1;
+
+	/* large matrices are built on the shared pool, a chunk of rows per thread */
+	Pool *P = degree >= BERLEKAMP_PARALLEL_DEGREE ? shared_pool() : NULL;
+	MatrixRows M;
+	M.matrix = matrix;
+	M.p = p;
+	M.frobenius = pow_mod_p(x, F->p, p, F);
+	M.chunks = pool_width(P) < degree ? pool_width(P) : degree;
+	M.transposed = transposed;
+	M.F = F;
+	pool_for(P, M.chunks, fill_rows, &M);
+
+	free_polynomial(M.frobenius);
+	free_polynomial(x);
+}
+
+/** Fills in one chunk of the rows of a Berlekamp matrix. Rows x^(m*i) mod p
+ * are found from the previous row times x^m, so only the first row of each
+ * chunk is found by raising x^m to a power. */
+void fill_rows(void *arg, int chunk, int worker)
+{
+	(void) worker;
+	MatrixRows *M = arg;
+	Matrix *matrix = M->matrix;
+	int degree = M->p->degree;
+	int start = (long long) chunk * degree / M->chunks;
+	int end = (long long) (chunk + 1) * degree / M->chunks;
+
+	Polynomial *row, *helper;
+	if (start == 0) {
+		row = init_polynomial(0);
+		row->coefficients[0] = 1;
+	} else {
+		row = pow_mod_p(M->frobenius, start, M->p, M->F);
+	}
+
+	/* compute powers x^(m*i) mod p, each row being the previous times x^m */
+	for (int i = start; i < end; i++) {
+		for (int j = 0; j < degree && j <= row->degree; j++) {
+			if (M->transposed) {
+				MATRIX_ROW(matrix, j)[i] = row->coefficients[j];
+			} else {
+				MATRIX_ROW(matrix, i)[j] = row->coefficients[j];
+			}
+		}
+
+		if (i + 1 < end) {
+			helper = mul_mod_p(row, M->frobenius, M->p, M->F);
+			free_polynomial(row);
+			row = helper;
+		}
+	}
+
+	free_polynomial(row);
+}
+
+/** Replaces each of the first counter factors in facs with its non-trivial
+ * gcds with v - s, for s in Z_m, appending the new ones. Stops once there are
+ * max factors. The factors are monic, trimmed and allocated from A, and so is
+ * everything else, so the loop does no heap traffic. */
+void refine(Polynomial **facs, int *counter, int max, Polynomial *v,
+		Arena *A, Field *F)
+{
+	Polynomial *g, *h, *q, *r;
+	int n = *counter;
+	int count, d, split;
+
+	int largest = 0;
+	for (int j = 0; j < n; j++) {
+		largest = facs[j]->degree > largest ? facs[j]->degree : largest;
+	}
+	GcdRound R;
+	init_round(&R, v, largest, A, F);
+
+	for (int j = 0; j < n && *counter < max; j++) {
+		g = facs[j];
+		r = arena_polynomial(A, g->degree);
+		split = g->degree >= 2;
+
+		/* the gcds of a round are all taken with g as it was at the start of
+		 * the round, which gives the same ones as the g left after each split,
+		 * since gcds with v - s for different s are coprime */
+		for (coeff_t s = 0; s < F->p && *counter < max && split; s += count) {
+			count = run_round(&R, g, s);
+			for (int i = 0; i < count && *counter < max; i++) {
+				if (g->degree < 2) {
+					split = FALSE;
+					break;
+				}
+				h = R.gcds[i];
+				d = h->degree;
+				if (d == g->degree) {
+					/* h is all of g left */
+					split = FALSE;
+					break;
+				} else if (d == 0) {
+					continue;
+				}
+
+				/* g = h * (g / h), and both parts are kept monic */
+				facs[*counter] = arena_polynomial(A, d);
+				monic_p_into(facs[*counter], h, F);
+				q = arena_polynomial(A, g->degree - d);
+				long_div_into(q, r, g, facs[(*counter)++], F);
+				g = q;
+			}
+		}
+		facs[j] = g;
+	}
+}
+
+/** Prepares the scratch space for rounds of gcds of polynomials of degree at
+ * most degree with v - s. A round has one gcd for each thread of the shared
+ * pool if v is large enough to be worth sharing, and otherwise just one. */
+void init_round(GcdRound *R, Polynomial *v, int degree, Arena *A, Field *F)
+{
+	R->v = v;
+	R->c = field_elem(F, v->coefficients[0]);
+	R->pool = degree >= BERLEKAMP_PARALLEL_DEGREE ? shared_pool() : NULL;
+	R->width = pool_width(R->pool);
+	R->F = F;
+
+	int n = degree > v->degree ? degree : v->degree;
+	R->gcds = arena_alloc(A, sizeof(Polynomial *) * R->width);
+	R->vs = arena_alloc(A, sizeof(Polynomial *) * R->width);
+	R->work = arena_alloc(A, sizeof(coeff_t *) * R->width);
+	for (int i = 0; i < R->width; i++) {
+		R->gcds[i] = arena_polynomial(A, n);
+		R->vs[i] = arena_copy(A, v);
+		R->work[i] = arena_alloc(A, sizeof(coeff_t) * (degree + v->degree + 2));
+	}
+}
+
+/** Finds the gcds of f with v - s, v - s - 1, ... for a round, stopping at the
+ * end of Z_m, and returns how many were found */
+int run_round(GcdRound *R, Polynomial *f, coeff_t s)
+{
+	int count = R->F->p - s < R->width ? (int) (R->F->p - s) : R->width;
+	R->f = f;
+	R->s = s;
+	pool_for(R->pool, count, round_gcd, R);
+	return count;
+}
+
+/** Finds gcd(f, v - s - i) for one gcd of a round, on the given thread */
+void round_gcd(void *arg, int i, int worker)
+{
+	GcdRound *R = arg;
+	Polynomial *v = R->vs[worker];
+	v->coefficients[0] = field_sub(R->F, R->c, R->s + i);
+	gcd_p_into(R->gcds[i], R->f, v, R->work[worker], R->F);
+}
+
+/** Returns the highest non-zero coefficient of a polynomial */
+coeff_t leading_coefficient(Polynomial *p)
+{
+	if (is_normalized(p)) {
+		return p->lc;
+	}
+	int i = p->degree;
+	while (i > 0 && p->coefficients[i] == 0) {
+		i--;
+	}
+	return p->coefficients[i];
+}
+
+/** Returns the actual degree of a polynomial, which is 0 if it is zero */
+int actual_degree(Polynomial *p)
+{
+	if (is_normalized(p)) {
+		return p->degree;
+	}
+	int i = p->degree;
+	while (i > 0 && p->coefficients[i] == 0) {
+		i--;
+	}
+	return i;
+}
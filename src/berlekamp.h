@@ -6,7 +6,15 @@
 #ifndef BERLEKAMP
 #define BERLEKAMP
 
+#include "arena.h"
+#include "counters.h"
 #include "euclid.h"
+#include "matrix.h"
+
+/* Degree from which the rows of the Berlekamp matrix and the gcds which split
+ * factors with elements of the subalgebra are shared out between the threads
+ * of the shared pool, if one has been set */
+#define BERLEKAMP_PARALLEL_DEGREE 64
 
 /**
  * Find Berlekamp matrix. Berlekamp subalgebra is kernel of matrix derived from
@@ -14,53 +22,56 @@
  *
  * @param[in] p
  *     polynomial f(x) which we will use to calculate matrix
- * @param[in] m
- *     prime number so that we work over field Z_m
+ * @param[in] F
+ *     the field Z_m, where m is prime
  * @return    Berlekamp matrix derived from p = f(x)
  */
-int **get_berlekamp_matrix(Polynomial *p, int m);
+Matrix *get_berlekamp_matrix(Polynomial *p, Field *F);
+
+/**
+ * Find the transpose of the Berlekamp matrix, built directly by writing each
+ * power of x into a column. The right null space of this minus the identity is
+ * the Berlekamp subalgebra, so no separate transpose is needed.
+ *
+ * @param[in] p
+ *     polynomial f(x) which we will use to calculate matrix
+ * @param[in] F
+ *     the field Z_m, where m is prime
+ * @return    transpose of the Berlekamp matrix derived from p = f(x)
+ */
+Matrix *get_berlekamp_transpose(Polynomial *p, Field *F);
 
 /**
- * Transpose an m x n matrix, in place.
+ * Transpose a matrix, in place. Square matrices keep their storage, and others
+ * have their entries moved into a single new block.
  *
  * @param[in] A
- *     pointer to a double pointer which should store transposed matrix
- * @param[in] m
- *     the number of rows in the matrix
- * @param[in] n
- *     the number of columns in the matrix
+ *     pointer to the matrix to be transposed
  */
-void transpose(int ***A, int m, int n);
+void transpose(Matrix *A);
 
 /**
  * Subtracts the identity matrix from the provided matrix if possible.
  *
  * @param[in] A
- *     double pointer to a matrix
- * @param[in] m
- *     the number of rows in the matrix
- * @param[in] n
- *     the number of columns in the matrix
- * @param[in] p
- *     the modulus we are working with (Z_p is a field)
+ *     pointer to a square matrix
+ * @param[in] F
+ *     the field Z_p we are working with
  */
-void subtract_identity(int **A, int m, int n, int p);
+void subtract_identity(Matrix *A, Field *F);
 
 /**
  * Performs Gauss-Jordan elimination on the given matrix to get it in reduced
  * row echelon form. This is done in place, so the original matrix passed as
- * input is lost.
+ * input is lost. Rows are reduced with row_mul_add, which is vectorised where
+ * the target supports it.
  *
  * @param[in] A
- *     double pointer to a matrix
- * @param[in] m
- *     the number of rows in the matrix
- * @param[in] n
- *     the number of columns in the matrix
- * @param[in] p
- *     the modulus we are working with (Z_p)
+ *     pointer to a matrix
+ * @param[in] F
+ *     the field Z_p we are working with, whose elements A should contain
  */
-void gauss_jordan(int **A, int m, int n, int p);
+void gauss_jordan(Matrix *A, Field *F);
 
 /**
  * Finds the (right) null space of a matrix given its reduced row echelon form.
@@ -70,16 +81,12 @@ void gauss_jordan(int **A, int m, int n, int p);
  * @param[in] rank
  *     pointer to an integer which we should store the rank in for later use
  * @param[in] R
- *     double pointer to a matrix in reduced row echelon form
- * @param[in] m
- *     the number of rows in the matrix
- * @param[in] n
- *     the number of columns in the matrix
- * @param[in] p
- *     the modulus we are working with (Z_p is a field)
+ *     pointer to a matrix in reduced row echelon form
+ * @param[in] F
+ *     the field Z_p we are working with
  * @return    a matrix whose rows contain the basis vectors for Rs null space
  */
-int **null_space(int *rank, int **R, int m, int n, int p);
+Matrix *null_space(int *rank, Matrix *R, Field *F);
 
 /**
  * Converts a matrix to an array of pointers to polynomials. Each row in the
@@ -87,17 +94,15 @@ int **null_space(int *rank, int **R, int m, int n, int p);
  *
  * @param[in] kernel
  *     a matrix of polynomial's coefficients
- * @param[in] m
- *     the number of rows in the matrix
- * @param[in] n
- *     the number of columns in the matrix
- * @return    an array of pointers to polynomials
+ * @return    an array of pointers to polynomials, one for each row
  */
-Polynomial **kernel_to_arr(int **kernel, int m, int n);
+Polynomial **kernel_to_arr(Matrix *kernel);
 
 /**
  * Takes in a polynomial and the polynomials in its berlekamp subalgebra to find
- * (potentially trivial) factors of a polynomial.
+ * (potentially trivial) factors of a polynomial. The gcds of p with g - s are
+ * taken for every s in Z_m, for one non-constant g in the subalgebra, and the
+ * non-trivial ones are returned first, followed by trivial factors.
  *
  * @param[in] p
  *     pointer to the polynomial to be factorised
@@ -105,11 +110,12 @@ Polynomial **kernel_to_arr(int **kernel, int m, int n);
  *     array of pointers to polynomials in p's Berlekamp subalgebra
  * @param[in] nullity
  *     the number of polynomials in the subalgebra
- * @param[in] m
- *     prime number for field Z_m
+ * @param[in] F
+ *     the field Z_m, where m is prime
  * @return    NULL if p is irreducible, else array of pointers to factors found
  */
-Polynomial **factors(Polynomial *p, Polynomial **subalgebra, int nullity, int m);
+Polynomial **factors(Polynomial *p, Polynomial **subalgebra, int nullity,
+		Field *F);
 
 /**
  * Frees memory allocated to an array of pointers to polynomials.
@@ -122,29 +128,50 @@ Polynomial **factors(Polynomial *p, Polynomial **subalgebra, int nullity, int m)
 void free_polynomials(Polynomial **polynomials, int nullity);
 
 /**
- * Frees memory allocated to a matrix with m rows and n columns.
+ * Berlekamp's algorithm. Takes in a square free polynomial defined over Z_m as
+ * input and returns an array of its irreducible factors, which are monic unless
+ * poly is irreducible. One matrix is reduced, and its null space is used to
+ * split poly until the nullity is reached. Over Z_2 this hands over to
+ * gf2_berlekamp, which works on packed bits.
  *
- * @param[in] matrix
- *     the matrix of integers to be freed
- * @param[in] m
- *     the number of rows in the matrix
- * @param[in] n
- *     the number of columns in the matrix
+ * @param[in] num_factors
+ *     pointer to the number of factors found, written to in function
+ * @param[in] poly
+ *     pointer to the polynomial over Z_m to be factorised
+ * @param[in] F
+ *     the field Z_m, where m is prime
+ * @return    an array of pointers to polynomial factors of poly
  */
-void free_matrix(int **matrix, int m);
+Polynomial **berlekamp(int *num_factors, Polynomial *poly, Field *F);
 
 /**
- * Berlekamp's algorithm. Takes in a polynomial defined over Z_m as input, finds
- * its square free factorization, and returns an array of its factors.
+ * Berlekamp's algorithm, as berlekamp, with the matrix and every intermediate
+ * polynomial allocated from an arena. Only the array of factors returned is
+ * allocated normally. The arena is not reset, so that one reset can release a
+ * whole factorisation made of several calls.
  *
  * @param[in] num_factors
  *     pointer to the number of factors found, written to in function
  * @param[in] poly
  *     pointer to the polynomial over Z_m to be factorised
- * @param[in] m
- *     prime number so that we can work over field Z_m
+ * @param[in] A
+ *     the arena to allocate intermediate results from
+ * @param[in] F
+ *     the field Z_m, where m is prime
  * @return    an array of pointers to polynomial factors of poly
  */
-Polynomial **berlekamp(int *num_factors, Polynomial *poly, int m);
+Polynomial **berlekamp_in(int *num_factors, Polynomial *poly, Arena *A,
+		Field *F);
+
+/**
+ * Finds the operations done by the last call of berlekamp or berlekamp_in on
+ * the calling thread, including any work it handed to the shared pool. These
+ * are all zero unless counting was compiled in and enabled, as described in
+ * counters.h.
+ *
+ * @param[out] c
+ *     where the counts should be written
+ */
+void berlekamp_counters(Counters *c);
 
 #endif
@@ -0,0 +1,348 @@
+/**
+ * @file    cantor.c
+ * @brief   Implementation of the Cantor-Zassenhaus algorithm, built on the
+ *          polynomial arithmetic in euclid.c.
+ */
+
+#include <stdlib.h>
+#include "cantor.h"
+
+/* Seed for the random polynomials used when splitting */
+#define CANTOR_SEED 0x9E3779B97F4A7C15ULL
+
+/* --- function prototypes ---------------------------------------------------*/
+
+static void split(Polynomial **facs, int *count, Polynomial *f, int d, Field *F,
+		unsigned long long *state);
+static Polynomial *splitting_poly(Polynomial *a, Polynomial *f, int d,
+		Field *F);
+static void split_roots(coeff_t *roots, int *count, Polynomial *f, Field *F,
+		unsigned long long *state);
+static int true_degree(Polynomial *p);
+static coeff_t random_elem(unsigned long long *state, Field *F);
+
+/* --- cantor interface ------------------------------------------------------*/
+
+Polynomial **distinct_degree(int *num_parts, int **degrees, Polynomial *poly,
+		Field *F)
+{
+	Polynomial *g = monic_p(poly, F);
+	int n = g->degree > 0 ? g->degree : 1;
+	Polynomial **parts = malloc(sizeof(Polynomial *) * n);
+	*degrees = malloc(sizeof(int) * n);
+	*num_parts = 0;
+
+	/* h = x^(m^i) mod g, found from the previous h by raising it to the m */
+	Polynomial *h = init_polynomial(1);
+	h->coefficients[1] = 1;
+	Polynomial *helper, *d, *q, *r;
+
+	for (int i = 1; 2 * i <= g->degree; i++) {
+		helper = pow_mod_p(h, F->p, g, F);
+		free_polynomial(h);
+		h = helper;
+
+		/* the product of all factors of g of degree i is gcd(g, h - x) */
+		helper = copy_polynomial(h);
+		helper->coefficients[1] = field_sub(F, helper->coefficients[1], 1);
+		d = gcd_p(g, helper, F);
+		free_polynomial(helper);
+
+		if (true_degree(d) > 0) {
+			parts[*num_parts] = monic_p(d, F);
+			(*degrees)[(*num_parts)++] = i;
+
+			/* remove the part from g, and keep h reduced mod the new g */
+			long_div(&q, &r, g, parts[*num_parts - 1], F);
+			free_polynomial(g);
+			free_polynomial(r);
+			g = monic_p(q, F);
+			free_polynomial(q);
+			long_div(&q, &r, h, g, F);
+			free_polynomial(h);
+			free_polynomial(q);
+			h = r;
+		}
+		free_polynomial(d);
+	}
+
+	/* whatever is left has no factors of degree at most half its own */
+	if (g->degree > 0) {
+		parts[*num_parts] = g;
+		(*degrees)[(*num_parts)++] = g->degree;
+	} else {
+		free_polynomial(g);
+	}
+	free_polynomial(h);
+
+	return parts;
+}
+
+Polynomial **equal_degree(int *num_factors, Polynomial *poly, int d, Field *F)
+{
+	Polynomial *f = monic_p(poly, F);
+	int n = f->degree / d > 0 ? f->degree / d : 1;
+	Polynomial **facs = malloc(sizeof(Polynomial *) * n);
+	unsigned long long state = CANTOR_SEED;
+
+	*num_factors = 0;
+	split(facs, num_factors, f, d, F, &state);
+
+	return facs;
+}
+
+Polynomial **cantor_zassenhaus(int *num_factors, Polynomial *poly, Field *F)
+{
+	Polynomial *f = monic_p(poly, F);
+	int n = f->degree;
+	Polynomial **facs = malloc(sizeof(Polynomial *) * (n > 1 ? n : 1));
+
+	if (n < 2) {
+		/* polynomial is irreducible */
+		free_polynomial(f);
+		*num_factors = 1;
+		*facs = copy_polynomial(poly);
+		return facs;
+	}
+
+	/* a repeated factor would be taken for several of degree d, and there
+	 * need be no a that splits copies of it apart, so refuse it here */
+	Polynomial *derivative = get_formal_derivative(f, F);
+	Polynomial *c = gcd_p(f, derivative, F);
+	int repeated = true_degree(c) > 0;
+	free_polynomial(derivative);
+	free_polynomial(c);
+	if (repeated) {
+		free_polynomial(f);
+		free(facs);
+		*num_factors = 0;
+		return NULL;
+	}
+
+	int num_parts, count, *degrees;
+	Polynomial **parts = distinct_degree(&num_parts, &degrees, f, F);
+	Polynomial **part_facs;
+
+	*num_factors = 0;
+	for (int i = 0; i < num_parts; i++) {
+		part_facs = equal_degree(&count, parts[i], degrees[i], F);
+		for (int j = 0; j < count; j++) {
+			facs[(*num_factors)++] = part_facs[j];
+		}
+		free(part_facs);
+		free_polynomial(parts[i]);
+	}
+	free(parts);
+	free(degrees);
+	free_polynomial(f);
+
+	return facs;
+}
+
+coeff_t *distinct_roots(int *num_roots, Polynomial *poly, Field *F)
+{
+	Polynomial *g = monic_p(poly, F);
+	coeff_t *roots = malloc(sizeof(coeff_t) * (g->degree > 0 ? g->degree : 1));
+	*num_roots = 0;
+	if (g->degree < 1) {
+		free_polynomial(g);
+		return roots;
+	}
+
+	/* the product of the distinct linear factors of g is gcd(g, x^m - x) */
+	Polynomial *x = init_polynomial(1);
+	x->coefficients[1] = 1;
+	Polynomial *h = pow_mod_p(x, F->p, g, F);
+	Polynomial *helper = init_polynomial(h->degree > 1 ? h->degree : 1);
+	for (int i = 0; i <= h->degree; i++) {
+		helper->coefficients[i] = h->coefficients[i];
+	}
+	helper->coefficients[1] = field_sub(F, helper->coefficients[1], 1);
+	Polynomial *l = gcd_p(g, helper, F);
+	free_polynomial(helper);
+	free_polynomial(h);
+	free_polynomial(x);
+	free_polynomial(g);
+
+	if (true_degree(l) < 1) {
+		free_polynomial(l);
+		return roots;
+	}
+
+	unsigned long long state = CANTOR_SEED;
+	split_roots(roots, num_roots, monic_p(l, F), F, &state);
+	free_polynomial(l);
+
+	return roots;
+}
+
+/* --- utility functions -----------------------------------------------------*/
+
+/** Splits the monic polynomial f, all of whose irreducible factors have degree
+ * d, appending the factors to facs. Takes ownership of f. */
+void split(Polynomial **facs, int *count, Polynomial *f, int d, Field *F,
+		unsigned long long *state)
+{
+	int n = f->degree;
+	if (n <= d) {
+		facs[(*count)++] = f;
+		return;
+	}
+
+	/* try random a until gcd(f, b(a)) is a proper factor, which happens for
+	 * about half of all a */
+	Polynomial *a = init_polynomial(n - 1);
+	Polynomial *b, *g;
+	int k;
+	while (TRUE) {
+		for (int i = 0; i < n; i++) {
+			a->coefficients[i] = random_elem(state, F);
+		}
+		if (true_degree(a) < 1) {
+			continue;
+		}
+
+		b = splitting_poly(a, f, d, F);
+		g = gcd_p(f, b, F);
+		free_polynomial(b);
+
+		k = true_degree(g);
+		if (k > 0 && k < n) {
+			break;
+		}
+		free_polynomial(g);
+	}
+	free_polynomial(a);
+
+	Polynomial *g1 = monic_p(g, F);
+	Polynomial *q, *r;
+	long_div(&q, &r, f, g1, F);
+	Polynomial *g2 = monic_p(q, F);
+	free_polynomial(g);
+	free_polynomial(q);
+	free_polynomial(r);
+	free_polynomial(f);
+
+	split(facs, count, g1, d, F, state);
+	split(facs, count, g2, d, F, state);
+}
+
+/** Splits the monic polynomial f, a product of distinct linear factors,
+ * appending its roots to roots. Takes ownership of f. */
+void split_roots(coeff_t *roots, int *count, Polynomial *f, Field *F,
+		unsigned long long *state)
+{
+	int n = f->degree;
+	if (n == 1) {
+		roots[(*count)++] = field_neg(F, f->coefficients[0]);
+		free_polynomial(f);
+		return;
+	}
+
+	/* over Z_2 the only roots are 0 and 1, and both are roots here */
+	if (F->p == 2) {
+		roots[(*count)++] = 0;
+		roots[(*count)++] = 1;
+		free_polynomial(f);
+		return;
+	}
+
+	/* (r + a)^((m - 1)/2) is 1 for about half of all a, so try random a until
+	 * gcd(f, (x + a)^((m - 1)/2) - 1) is a proper factor */
+	Polynomial *a = init_polynomial(1);
+	a->coefficients[1] = 1;
+	Polynomial *b, *g;
+	int k;
+	while (TRUE) {
+		a->coefficients[0] = random_elem(state, F);
+		b = pow_mod_p(a, (F->p - 1) / 2, f, F);
+		b->coefficients[0] = field_sub(F, b->coefficients[0], 1);
+		g = gcd_p(f, b, F);
+		free_polynomial(b);
+
+		k = true_degree(g);
+		if (k > 0 && k < n) {
+			break;
+		}
+		free_polynomial(g);
+	}
+	free_polynomial(a);
+
+	Polynomial *g1 = monic_p(g, F);
+	Polynomial *q, *r;
+	long_div(&q, &r, f, g1, F);
+	Polynomial *g2 = monic_p(q, F);
+	free_polynomial(g);
+	free_polynomial(q);
+	free_polynomial(r);
+	free_polynomial(f);
+
+	split_roots(roots, count, g1, F, state);
+	split_roots(roots, count, g2, F, state);
+}
+
+/** Returns a^((m^d - 1)/2) - 1 mod f for odd m, or the trace
+ * a + a^2 + ... + a^(2^(d-1)) mod f for m = 2. Mod each irreducible factor of f
+ * this is 0 with probability about 1/2. */
+Polynomial *splitting_poly(Polynomial *a, Polynomial *f, int d, Field *F)
+{
+	Polynomial *s = copy_polynomial(a);
+	Polynomial *t = copy_polynomial(a);
+	Polynomial *helper;
+
+	for (int k = 1; k < d; k++) {
+		if (F->p == 2) {
+			/* t = a^(2^k), s = s + t */
+			helper = mul_mod_p(t, t, f, F);
+			free_polynomial(t);
+			t = helper;
+			for (int i = 0; i <= t->degree; i++) {
+				s->coefficients[i] = field_add(F, s->coefficients[i],
+						t->coefficients[i]);
+			}
+		} else {
+			/* t = a^(m^k), s = a^(1 + m + ... + m^k) */
+			helper = pow_mod_p(t, F->p, f, F);
+			free_polynomial(t);
+			t = helper;
+			helper = mul_mod_p(s, t, f, F);
+			free_polynomial(s);
+			s = helper;
+		}
+	}
+	free_polynomial(t);
+
+	if (F->p == 2) {
+		return s;
+	}
+
+	/* a^((m^d - 1)/2) = s^((m - 1)/2) */
+	helper = pow_mod_p(s, (F->p - 1) / 2, f, F);
+	free_polynomial(s);
+	helper->coefficients[0] = field_sub(F, helper->coefficients[0], 1);
+	return helper;
+}
+
+/** Returns the actual degree of a polynomial, or -1 for the zero polynomial */
+int true_degree(Polynomial *p)
+{
+	if (is_normalized(p)) {
+		return p->degree;
+	}
+	for (int i = p->degree; i >= 0; i--) {
+		if (p->coefficients[i] != 0) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+/** Returns a pseudorandom element of Z_m, from a xorshift generator */
+coeff_t random_elem(unsigned long long *state, Field *F)
+{
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+	unsigned long long x = *state * 0x2545F4914F6CDD1DULL;
+	return (coeff_t) (x % (unsigned long long) F->p);
+}
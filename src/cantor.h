@@ -0,0 +1,87 @@
+/**
+ * @file    cantor.h
+ * @brief   Prototypes for the Cantor-Zassenhaus algorithm for factorising
+ *          polynomials over finite fields.
+ */
+
+#ifndef CANTOR
+#define CANTOR
+
+#include "euclid.h"
+
+/**
+ * Distinct degree factorisation. Splits a square free polynomial into parts
+ * whose irreducible factors all have the same degree, using
+ * gcd(f, x^(m^i) - x) for i = 1, 2, ...
+ *
+ * @param[out] num_parts
+ *     pointer to where the number of parts should be written
+ * @param[out] degrees
+ *     pointer to where an array holding the degree of the irreducible factors
+ *     of each part should be written
+ * @param[in]  poly
+ *     pointer to the square free polynomial to be split
+ * @param[in]  F
+ *     the field Z_m, where m is prime
+ * @return     an array of pointers to the monic parts of poly
+ */
+Polynomial **distinct_degree(int *num_parts, int **degrees, Polynomial *poly,
+		Field *F);
+
+/**
+ * Equal degree factorisation. Splits a square free polynomial whose irreducible
+ * factors all have degree d by taking gcds with a^((m^d - 1)/2) - 1 for random
+ * a, or with the trace a + a^2 + ... + a^(2^(d-1)) when m = 2. There are then
+ * at most deg(poly) / d factors.
+ *
+ * @param[out] num_factors
+ *     pointer to where the number of factors found should be written
+ * @param[in]  poly
+ *     pointer to the polynomial to be split
+ * @param[in]  d
+ *     the degree of every irreducible factor of poly
+ * @param[in]  F
+ *     the field Z_m, where m is prime
+ * @return     an array of pointers to the monic irreducible factors of poly
+ */
+Polynomial **equal_degree(int *num_factors, Polynomial *poly, int d, Field *F);
+
+/**
+ * The Cantor-Zassenhaus algorithm, with the same contract as berlekamp. Runs
+ * distinct degree factorisation and then equal degree factorisation on each
+ * part. Random choices are seeded the same way on every call, so the output
+ * is reproducible. Square freeness is checked first, with a gcd of poly and its
+ * derivative, since the splitting relies on it.
+ *
+ * @param[out] num_factors
+ *     pointer to the number of factors found, written to in function
+ * @param[in]  poly
+ *     pointer to the square free polynomial over Z_m to be factorised
+ * @param[in]  F
+ *     the field Z_m, where m is prime
+ * @return     an array of pointers to polynomial factors of poly, or NULL with
+ *             no factors if poly is not square free
+ */
+Polynomial **cantor_zassenhaus(int *num_factors, Polynomial *poly, Field *F);
+
+/**
+ * Finds the distinct roots of a polynomial in Z_m, without factorising it. The
+ * product of its distinct linear factors is gcd(poly, x^m - x), with x^m found
+ * mod poly by repeated squaring, and that is split by gcds with
+ * (x + a)^((m - 1)/2) - 1 for random a, each of which takes about half of the
+ * roots. Every step costs a power mod a polynomial of degree at most that of
+ * poly, so the cost is polynomial in log m rather than in m. Random choices are
+ * seeded the same way on every call.
+ *
+ * @param[out] num_roots
+ *     pointer to where the number of roots should be written
+ * @param[in]  poly
+ *     pointer to the non-zero polynomial over Z_m
+ * @param[in]  F
+ *     the field Z_m, where m is prime
+ * @return     an array of the roots in Z_m, in no particular order, ready to be
+ *             lifted with hensel_roots or lift_roots
+ */
+coeff_t *distinct_roots(int *num_roots, Polynomial *poly, Field *F);
+
+#endif
@@ -0,0 +1,89 @@
+/**
+ * @file    counters.c
+ * @brief   Implementation of the operation counts kept by each thread.
+ */
+
+#include <string.h>
+#include "counters.h"
+
+#ifdef COUNT_OPERATIONS
+int counting = 0;
+_Thread_local Counters thread_counters;
+#endif
+
+/* --- counters interface ----------------------------------------------------*/
+
+int counters_available(void)
+{
+#ifdef COUNT_OPERATIONS
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+void enable_counters(int on)
+{
+#ifdef COUNT_OPERATIONS
+	counting = on;
+#else
+	(void) on;
+#endif
+}
+
+void get_counters(Counters *c)
+{
+#ifdef COUNT_OPERATIONS
+	*c = thread_counters;
+#else
+	memset(c, 0, sizeof(Counters));
+#endif
+}
+
+void set_counters(Counters *c)
+{
+#ifdef COUNT_OPERATIONS
+	thread_counters = *c;
+#else
+	(void) c;
+#endif
+}
+
+void reset_counters(void)
+{
+#ifdef COUNT_OPERATIONS
+	memset(&thread_counters, 0, sizeof(Counters));
+#endif
+}
+
+void add_counters(Counters *to, Counters *from)
+{
+	to->long_divs += from->long_divs;
+	to->gcds += from->gcds;
+	to->reductions += from->reductions;
+	to->inversions += from->inversions;
+	to->polynomials += from->polynomials;
+	to->bytes += from->bytes;
+	to->row_ops += from->row_ops;
+	to->matrices += from->matrices;
+}
+
+void sub_counters(Counters *d, Counters *after, Counters *before)
+{
+	d->long_divs = after->long_divs - before->long_divs;
+	d->gcds = after->gcds - before->gcds;
+	d->reductions = after->reductions - before->reductions;
+	d->inversions = after->inversions - before->inversions;
+	d->polynomials = after->polynomials - before->polynomials;
+	d->bytes = after->bytes - before->bytes;
+	d->row_ops = after->row_ops - before->row_ops;
+	d->matrices = after->matrices - before->matrices;
+}
+
+void print_counters(FILE *stream, Counters *c)
+{
+	fprintf(stream, "long_divs=%llu gcds=%llu reductions=%llu inversions=%llu "
+			"polynomials=%llu bytes=%llu row_ops=%llu matrices=%llu",
+			c->long_divs, c->gcds, c->reductions, c->inversions,
+			c->polynomials, c->bytes, c->row_ops, c->matrices);
+}
@@ -0,0 +1,118 @@
+/**
+ * @file    counters.h
+ * @brief   Counts of the operations done by the arithmetic kernels, for finding
+ *          out where the time of a slow factorisation goes.
+ *
+ * Counting is only compiled in if COUNT_OPERATIONS is defined, as reductions
+ * happen in the innermost loops, and without it COUNT expands to nothing. Even
+ * then nothing is counted until enable_counters is called, which costs one
+ * well predicted branch per counted operation.
+ *
+ * Each thread keeps its own counts, so counting needs no locks. Work that
+ * pool_for and pool_fork hand to other threads is counted for the thread that
+ * asked for it, so the counts of a thread cover everything it started.
+ */
+
+#ifndef COUNTERS
+#define COUNTERS
+
+#include <stdio.h>
+
+typedef struct counters {
+	unsigned long long long_divs;   /* long_div and long_div_into calls */
+	unsigned long long gcds;        /* gcd_p, gcd_p_into and ext_gcd_p calls */
+	unsigned long long reductions;  /* products and other values reduced mod p */
+	unsigned long long inversions;  /* field_inv calls */
+	unsigned long long polynomials; /* polynomials allocated, from an arena or
+	                                 * not */
+	unsigned long long bytes;       /* bytes of coefficients they were given */
+	unsigned long long row_ops;     /* row_mul_add and swap_rows calls */
+	unsigned long long matrices;    /* Berlekamp matrices built */
+} Counters;
+
+#ifdef COUNT_OPERATIONS
+extern int counting;
+extern _Thread_local Counters thread_counters;
+
+/* Adds n to one of the counts of the calling thread, if counting is enabled */
+#define COUNT(field, n) do { \
+	if (counting) { \
+		thread_counters.field += (n); \
+	} \
+} while (0)
+#else
+#define COUNT(field, n) ((void) 0)
+#endif
+
+/**
+ * Checks whether counting was compiled in, with COUNT_OPERATIONS defined.
+ *
+ * @return    true if the counts can be anything but zero
+ */
+int counters_available(void);
+
+/**
+ * Starts or stops counting, on every thread. This is not locked, so it should
+ * be done before any work that is to be counted starts.
+ *
+ * @param[in] on
+ *     true to start counting, false to stop
+ */
+void enable_counters(int on);
+
+/**
+ * Copies the counts of the calling thread.
+ *
+ * @param[out] c
+ *     where the counts should be written
+ */
+void get_counters(Counters *c);
+
+/**
+ * Overwrites the counts of the calling thread, eg to put back ones saved by
+ * get_counters.
+ *
+ * @param[in] c
+ *     the new counts
+ */
+void set_counters(Counters *c);
+
+/**
+ * Sets every count of the calling thread to zero.
+ */
+void reset_counters(void);
+
+/**
+ * Adds one set of counts to another.
+ *
+ * @param[in,out] to
+ *     the counts to be added to
+ * @param[in]     from
+ *     the counts to add
+ */
+void add_counters(Counters *to, Counters *from);
+
+/**
+ * Finds the counts of what was done between two calls of get_counters.
+ *
+ * @param[out] d
+ *     where after - before should be written
+ * @param[in]  after
+ *     the later counts
+ * @param[in]  before
+ *     the earlier counts
+ */
+void sub_counters(Counters *d, Counters *after, Counters *before);
+
+/**
+ * Prints counts to a stream, on one line as name=value pairs separated by
+ * spaces, with no newline at the end.
+ *
+ * @param[in] stream
+ *     the stream to print to
+ * @param[in] c
+ *     the counts to be printed
+ */
+void print_counters(FILE *stream, Counters *c);
+
+#endif
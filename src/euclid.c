@@ -7,12 +7,56 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include "euclid.h"
+#include "ntt.h"
+
+/* A 2 x 2 matrix of polynomials, m[i][j] in row i and column j. Every one used
+ * here is a product of Euclid steps (0 1; 1 -q), so it has determinant +-1 and
+ * preserves the gcd of the pair it is applied to. */
+typedef struct gcd_matrix {
+	Polynomial *m[2][2];
+} GcdMatrix;
 
 /* --- function prototypes --------------------------------------------------*/
 
-static int lc(Polynomial *p);
-static int degree(Polynomial *p);
-static int is_zero(Polynomial *p);
+static void reduce_p(coeff_t *q, coeff_t *r, int deg_r, coeff_t *f, int n,
+		coeff_t inv, Field *F);
+static void cache_lc(Polynomial *p);
+static coeff_t lc_inverse(Polynomial *p, int n, Field *F);
+static int reduced_copy(coeff_t *a, Polynomial *p, Field *F);
+static coeff_t *reduced_coefficients(Polynomial *p, int *n, Field *F);
+static coeff_t *product(coeff_t *a, int na, coeff_t *b, int nb, Field *F);
+static void mul_coeffs(coeff_t *r, coeff_t *a, int na, coeff_t *b, int nb,
+		coeff_t *scratch, Field *F);
+static void schoolbook(coeff_t *r, coeff_t *a, int na, coeff_t *b, int nb,
+		Field *F);
+static void karatsuba(coeff_t *r, coeff_t *a, coeff_t *b, int n,
+		coeff_t *scratch, Field *F);
+static void toom3(coeff_t *r, coeff_t *a, coeff_t *b, int n, coeff_t *scratch,
+		Field *F);
+static void toom3_eval(coeff_t *e, coeff_t *a, int k, int l, coeff_t point,
+		Field *F);
+static size_t scratch_size(int na, int nb, Field *F);
+static Polynomial *fast_gcd(Polynomial **s, Polynomial **t, Polynomial *p1,
+		Polynomial *p2, Field *F);
+static GcdMatrix *half_gcd(Polynomial **c, Polynomial **d, Polynomial *a,
+		Polynomial *b, Field *F);
+static void add_low_part(Polynomial **c, Polynomial **d, GcdMatrix *M,
+		Polynomial *a, Polynomial *b, int k, Field *F);
+static GcdMatrix *init_gcd_matrix(void);
+static void free_gcd_matrix(GcdMatrix *M);
+static GcdMatrix *matrix_product(GcdMatrix *M, GcdMatrix *N, Field *F);
+static void matrix_step(GcdMatrix *M, Polynomial *q, Field *F);
+static void divide(Polynomial **q, Polynomial **r, Polynomial *a,
+		Polynomial *b, Field *F);
+static Polynomial *trimmed(Polynomial *p, Field *F);
+static Polynomial *shift_down(Polynomial *p, int k);
+static Polynomial *low_part(Polynomial *p, int k, Field *F);
+static Polynomial *combine(Polynomial *a, Polynomial *x, Polynomial *b,
+		Polynomial *y, Field *F);
+static Polynomial *finished(Polynomial *p);
+static coeff_t *series_inverse(coeff_t *g, int ng, int len, Field *F);
+static void mul_mod(coeff_t *r, coeff_t *a, coeff_t *b, coeff_t *f, int n,
+		coeff_t *f_inv, coeff_t inv, Field *F);
 
 /* --- euclid interface -----------------------------------------------------*/
 
@@ -60,189 +104,1167 @@ void free_polynomial(Polynomial *polynomial)
 
 Polynomial *init_polynomial(int degree)
 {
+	COUNT(polynomials, 1);
+	COUNT(bytes, sizeof(coeff_t) * (degree + 1));
 	Polynomial *p = malloc(sizeof(Polynomial));
 	p->degree = degree;
-	p->coefficients = malloc(sizeof(int) * (degree + 1));
+	p->coefficients = malloc(sizeof(coeff_t) * (degree + 1));
 	for (int i = 0; i <= degree; i++) {
 		p->coefficients[i] = 0;
 	}
+	p->lc = 0;
+	p->lc_inv = 0;
 	return p;
 }
 
 Polynomial *copy_polynomial(Polynomial *poly)
 {
+	COUNT(polynomials, 1);
+	COUNT(bytes, sizeof(coeff_t) * (poly->degree + 1));
 	Polynomial *new_poly = malloc(sizeof(Polynomial));
 	new_poly->degree = poly->degree;
-	new_poly->coefficients = malloc(sizeof(int) * (new_poly->degree + 1));
+	new_poly->coefficients = malloc(sizeof(coeff_t) * (new_poly->degree + 1));
 	for (int i = 0; i <= poly->degree; i++) {
 		new_poly->coefficients[i] = poly->coefficients[i];
 	}
+	new_poly->lc = poly->lc;
+	new_poly->lc_inv = poly->lc_inv;
 	return new_poly;
 }
 
+int normalize_p(Polynomial *p, Field *F)
+{
+	if (is_normalized(p)) {
+		if (p->lc_inv == 0) {
+			p->lc_inv = field_inv(F, p->lc);
+		}
+		return p->degree;
+	}
+
+	int d = reduced_copy(p->coefficients, p, F);
+	p->degree = d > 0 ? d : 0;
+	p->lc = d >= 0 ? p->coefficients[d] : 0;
+	p->lc_inv = d >= 0 ? field_inv(F, p->lc) : 0;
+	return p->degree;
+}
+
 Polynomial *scan_polynomial()
 {
 	printf("Enter the degree of your polynomial:\n");
 	Polynomial *polynomial = malloc(sizeof(Polynomial));
 	scanf("%d", &polynomial->degree);
+	polynomial->lc = 0;
+	polynomial->lc_inv = 0;
 
 	printf("Enter the coefficients of your polynomial (from lowest order term to highest):\n");
-	polynomial->coefficients = malloc(sizeof(int) * (polynomial->degree + 1));
+	polynomial->coefficients = malloc(sizeof(coeff_t) *
+			(polynomial->degree + 1));
 	for (int i = 0; i <= polynomial->degree; i++) {
-		scanf("%d", polynomial->coefficients + i);
+		scanf(COEFF_FMT, polynomial->coefficients + i);
 	}
 
 	return polynomial;
 }
 
+Polynomial *read_polynomial(FILE *stream)
+{
+	int degree;
+	if (fscanf(stream, "%d", &degree) != 1 || degree < 0) {
+		return NULL;
+	}
+
+	Polynomial *polynomial = init_polynomial(degree);
+	for (int i = 0; i <= degree; i++) {
+		if (fscanf(stream, COEFF_FMT, polynomial->coefficients + i) != 1) {
+			free_polynomial(polynomial);
+			return NULL;
+		}
+	}
+
+	return polynomial;
+}
 
 void print_polynomial(Polynomial *polynomial)
+{
+	fprint_polynomial(stdout, polynomial);
+}
+
+void fprint_polynomial(FILE *stream, Polynomial *polynomial)
 {
 	int printed_first_term = FALSE;
-	int *p = polynomial->coefficients;
+	coeff_t *p = polynomial->coefficients;
 	int n = polynomial->degree;
 
 	/* print polynomial */
 	for (int i = 0; i <= n; i++) {
 		if (p[i] != 0) {
 			if (!printed_first_term) {
-				printf("%d", p[i]);
+				fprintf(stream, COEFF_FMT, p[i]);
 				printed_first_term = TRUE;
 			} else {
-				printf(" + %d", p[i]);
+				fprintf(stream, " + " COEFF_FMT, p[i]);
 			}
 			if (i != 0) {
-				printf("*x^%d", i);
+				fprintf(stream, "*x^%d", i);
 			}
 		}
 	}
 
 	if (!printed_first_term) {
-		printf("0");
+		fprintf(stream, "0");
 	}
 }
 
-Polynomial *get_formal_derivative(Polynomial *p, int m)
+Polynomial *get_formal_derivative(Polynomial *p, Field *F)
 {
-	Polynomial *derivative = malloc(sizeof(Polynomial));
-	derivative->degree = p->degree; /* not -1 in case p is already constant */
-	derivative->coefficients = malloc(sizeof(int) * (p->degree + 1));
+	/* degree is not -1 in case p is already constant */
+	Polynomial *derivative = init_polynomial(p->degree);
+	get_formal_derivative_into(derivative, p, F);
+	return derivative;
+}
 
+void get_formal_derivative_into(Polynomial *d, Polynomial *p, Field *F)
+{
+	coeff_t k = 0; /* i + 1 in Z_m, kept without dividing */
 	for (int i = 0; i < p->degree; i++) {
-		derivative->coefficients[i] = mod((i + 1) * p->coefficients[i + 1], m);
+		k = field_add(F, k, 1);
+		d->coefficients[i] = field_mul(F, k,
+				field_elem(F, p->coefficients[i + 1]));
 	}
 	/* highest powers coefficient falls away */
-	derivative->coefficients[p->degree] = 0;
-
-	return derivative;
+	d->coefficients[p->degree] = 0;
+	d->degree = p->degree;
+	cache_lc(d);
 }
 
 void long_div(Polynomial **q, Polynomial **r, Polynomial *p1, Polynomial *p2, 
-		int m)
+		Field *F)
 {
-	/* initialize quotient */
 	*q = init_polynomial(p1->degree); /* has a max degree of deg(r)-deg(p2) */
-
-	/* initialize remainder */
 	*r = init_polynomial(p1->degree);
-	for (int i = 0; i <= p1->degree; i++) {
-		(*r)->coefficients[i] = p1->coefficients[i];
+
+	Polynomial *b = init_polynomial(p2->degree);
+	reduced_copy(b->coefficients, p2, F);
+	b->lc = p2->lc;
+	b->lc_inv = p2->lc_inv;
+	long_div_into(*q, *r, p1, b, F);
+	free_polynomial(b);
+}
+
+void long_div_into(Polynomial *q, Polynomial *r, Polynomial *p1,
+		Polynomial *p2, Field *F)
+{
+	COUNT(long_divs, 1);
+
+	/* a normalized divisor needs no scan for its degree */
+	int n = p2->degree;
+	if (!is_normalized(p2)) {
+		while (n > 0 && p2->coefficients[n] == 0) {
+			n--;
+		}
 	}
-	Polynomial *sb = init_polynomial(p1->degree + p2->degree);
+	int deg_r = reduced_copy(r->coefficients, p1, F);
 
-	/* initialize helper variables */
-	int d = degree(p2);
-	int c = lc(p2);
-	int deg_r = degree(*r);
-	int mult_factor, s, t;
+	if (deg_r < n) {
+		/* p2 does not go into p1 at all */
+		q->degree = 0;
+		q->coefficients[0] = 0;
+		cache_lc(q);
+		r->degree = deg_r > 0 ? deg_r : 0;
+		cache_lc(r);
+		return;
+	}
 
-	while (deg_r >= d && !is_zero(*r)) {
-		/* calculate polynomial s*p2 (stored in sb) */
-		extended_gcd_z(&s, &t, mod(c, m), m);
-		mult_factor = mod(lc(*r) * s, m);
+	reduce_p(q->coefficients, r->coefficients, deg_r, p2->coefficients, n,
+			lc_inverse(p2, n, F), F);
+	q->degree = deg_r - n;
+	cache_lc(q);
+	r->degree = n > 0 ? n - 1 : 0;
+	while (r->degree > 0 && r->coefficients[r->degree] == 0) {
+		r->degree--;
+	}
+	cache_lc(r);
+}
+
+Polynomial *rem_p(Polynomial *p, Polynomial *f, Field *F)
+{
+	COUNT(long_divs, 1);
+	int n, na;
+	coeff_t *g = reduced_coefficients(f, &n, F);
+	n--; /* the degree of f */
+	coeff_t *a = reduced_coefficients(p, &na, F);
+	int da = na - 1;
 
-		/* calculate s*b, = lc(r)/c * x^(deg(r)-d) * b */
-		for (int i = 0; i <= sb->degree; i++) {
-			sb->coefficients[i] = 0;
+	if (da >= n && n < DIVISION_THRESHOLD) {
+		reduce_p(NULL, a, da, g, n, lc_inverse(f, n, F), F);
+	} else if (da >= n) {
+		/* the quotient has m coefficients, and reversed it is the top of p
+		 * reversed times 1 / rev(f), mod x^m */
+		int m = da - n + 1;
+		coeff_t *rev = malloc(sizeof(coeff_t) * (n + 1));
+		for (int i = 0; i <= n; i++) {
+			rev[i] = g[n - i];
+		}
+		coeff_t *f_inv = series_inverse(rev, n + 1, m, F);
+		coeff_t *q = malloc(sizeof(coeff_t) * m);
+		for (int i = 0; i < m; i++) {
+			q[i] = a[da - i];
 		}
-		for (int i = 0; i <= p2->degree; i++) {
-			sb->coefficients[i + (deg_r - d)] = p2->coefficients[i] * mult_factor;
+		coeff_t *q_rev = product(q, m, f_inv, m, F);
+		for (int i = 0; i < m; i++) {
+			q[i] = q_rev[m - 1 - i];
 		}
 
-		/* q = q + s */
-		(*q)->coefficients[deg_r - d] = mod((*q)->coefficients[deg_r - d] +
-				mult_factor, m);
+		/* only the lowest n coefficients of p - q * f are left */
+		coeff_t *qf = product(q, m, g, n + 1, F);
+		for (int i = 0; i < n; i++) {
+			a[i] = field_sub(F, a[i], qf[i]);
+		}
+
+		free(qf);
+		free(q);
+		free(q_rev);
+		free(f_inv);
+		free(rev);
+	}
+
+	Polynomial *r = init_polynomial(n > 0 ? n - 1 : 0);
+	for (int i = 0; i < n && i <= da; i++) {
+		r->coefficients[i] = a[i];
+	}
+	while (r->degree > 0 && r->coefficients[r->degree] == 0) {
+		r->degree--;
+	}
+	cache_lc(r);
+
+	free(a);
+	free(g);
+
+	return r;
+}
+
+Polynomial *gcd_p(Polynomial *p1, Polynomial *p2, Field *F)
+{
+	COUNT(gcds, 1);
+	return fast_gcd(NULL, NULL, p1, p2, F);
+}
+
+Polynomial *ext_gcd_p(Polynomial **s, Polynomial **t, Polynomial *p1,
+		Polynomial *p2, Field *F)
+{
+	COUNT(gcds, 1);
+	return fast_gcd(s, t, p1, p2, F);
+}
+
+void gcd_p_into(Polynomial *g, Polynomial *p1, Polynomial *p2, coeff_t *work,
+		Field *F)
+{
+	COUNT(gcds, 1);
+	int min = p1->degree < p2->degree ? p1->degree : p2->degree;
+	if (min >= GCD_THRESHOLD) {
+		Polynomial *h = fast_gcd(NULL, NULL, p1, p2, F);
+		for (int i = 0; i <= h->degree; i++) {
+			g->coefficients[i] = h->coefficients[i];
+		}
+		g->degree = h->degree;
+		cache_lc(g);
+		free_polynomial(h);
+		return;
+	}
+
+	/* the remainder sequence, each remainder overwriting the older dividend */
+	coeff_t *a = work;
+	coeff_t *b = work + p1->degree + 1;
+	coeff_t *helper;
+	int da = reduced_copy(a, p1, F);
+	int db = reduced_copy(b, p2, F);
+	int d;
 
-		/* r = r - sb */
-		for (int i = 0; i <= (*r)->degree; i++) {
-			(*r)->coefficients[i] = mod((*r)->coefficients[i] - sb->coefficients[i], m);
+	while (db >= 0) {
+		if (da >= db) {
+			reduce_p(NULL, a, da, b, db, field_inv(F, b[db]), F);
+			da = db - 1;
+			while (da >= 0 && a[da] == 0) {
+				da--;
+			}
 		}
+		helper = a;
+		a = b;
+		b = helper;
+		d = da;
+		da = db;
+		db = d;
+	}
 
-		/* recalculate deg_r */
-		deg_r = degree(*r);
+	g->degree = da > 0 ? da : 0;
+	g->coefficients[0] = 0;
+	for (int i = 0; i <= da; i++) {
+		g->coefficients[i] = a[i];
 	}
+	cache_lc(g);
+}
 
-	/* free sb, q and r should be handled after outside of function */
-	free_polynomial(sb);
+Polynomial *monic_p(Polynomial *p, Field *F)
+{
+	int n = p->degree;
+	while (!is_normalized(p) && n > 0
+			&& field_elem(F, p->coefficients[n]) == 0) {
+		n--;
+	}
+	Polynomial *m = init_polynomial(n);
+	monic_p_into(m, p, F);
+	return m;
 }
 
-Polynomial *gcd_p(Polynomial *p1, Polynomial *p2, int m)
+void monic_p_into(Polynomial *m, Polynomial *p, Field *F)
 {
-	/* initialize remainders to p1 and p2 */
-	Polynomial *r0 = init_polynomial(p1->degree);
-	for (int i = 0; i <= p1->degree; i++) {
-		r0->coefficients[i] = p1->coefficients[i];
+	int n = p->degree;
+	while (!is_normalized(p) && n >= 0
+			&& field_elem(F, p->coefficients[n]) == 0) {
+		n--;
 	}
-	Polynomial *r1 = init_polynomial(p2->degree);
-	for (int i = 0; i <= p2->degree; i++) {
-		r1->coefficients[i] = p2->coefficients[i];
+	if (n < 0) {
+		m->degree = 0;
+		m->coefficients[0] = 0;
+		cache_lc(m);
+		return;
 	}
-	Polynomial *helper, *q;
 
-	while (!is_zero(r1)) {
-		long_div(&q, &helper, r0, r1, m);
-		free_polynomial(r0);
-		free_polynomial(q);
-		r0 = r1;
-		r1 = helper;
+	coeff_t inv = lc_inverse(p, n, F);
+	for (int i = 0; i <= n; i++) {
+		m->coefficients[i] = field_mul(F, field_elem(F, p->coefficients[i]), inv);
 	}
+	m->degree = n;
+	m->lc = 1;
+	m->lc_inv = 1;
+}
 
-	free_polynomial(r1);
+Polynomial *poly_mul(Polynomial *p1, Polynomial *p2, Field *F)
+{
+	int n1, n2;
+	coeff_t *a = reduced_coefficients(p1, &n1, F);
+	coeff_t *b = reduced_coefficients(p2, &n2, F);
+	coeff_t *prod = product(a, n1, b, n2, F);
 
-	return r0;
+	Polynomial *r = init_polynomial(p1->degree + p2->degree);
+	for (int i = 0; i < n1 + n2 - 1; i++) {
+		r->coefficients[i] = prod[i];
+	}
+	cache_lc(r);
+
+	free(prod);
+	free(b);
+	free(a);
+
+	return r;
 }
 
-/* --- utility functions -----------------------------------------------------*/
+Polynomial *mul_mod_p(Polynomial *p1, Polynomial *p2, Polynomial *f, Field *F)
+{
+	int n, n1, n2;
+	coeff_t *g = reduced_coefficients(f, &n, F);
+	n--; /* the degree of f */
 
-/** Returns the leading coefficient of a polynomial */
-int lc(Polynomial *p)
+	coeff_t *a = reduced_coefficients(p1, &n1, F);
+	coeff_t *b = reduced_coefficients(p2, &n2, F);
+	coeff_t *prod = product(a, n1, b, n2, F);
+	int len = n1 + n2 - 2;
+
+	reduce_p(NULL, prod, len, g, n, lc_inverse(f, n, F), F);
+
+	/* the remainder has degree less than n */
+	Polynomial *r = init_polynomial(n > 0 ? n - 1 : 0);
+	for (int i = 0; i < n && i <= len; i++) {
+		r->coefficients[i] = prod[i];
+	}
+	cache_lc(r);
+
+	free(prod);
+	free(b);
+	free(a);
+	free(g);
+
+	return r;
+}
+
+Polynomial *pow_mod_p(Polynomial *base, long long exp, Polynomial *f,
+		Field *F)
 {
-	for (int i = p->degree; i >= 0; i--) {
-		if (p->coefficients[i] != 0) {
-			return p->coefficients[i];
+	int n;
+	coeff_t *g = reduced_coefficients(f, &n, F);
+	n--; /* the degree of f */
+	Polynomial *result = init_polynomial(n > 0 ? n - 1 : 0);
+	if (n == 0) {
+		/* everything is 0 mod a constant */
+		free(g);
+		return result;
+	}
+
+	/* for large f, divide by multiplying with the inverse of f reversed */
+	coeff_t *f_inv = NULL;
+	if (n >= DIVISION_THRESHOLD) {
+		coeff_t *rev = malloc(sizeof(coeff_t) * (n + 1));
+		for (int i = 0; i <= n; i++) {
+			rev[i] = g[n - i];
 		}
+		f_inv = series_inverse(rev, n + 1, n - 1, F);
+		free(rev);
 	}
-	return 0;
+
+	/* reduce the base once, then keep everything as n coefficients */
+	int nb;
+	coeff_t *b = reduced_coefficients(base, &nb, F);
+	coeff_t *x = malloc(sizeof(coeff_t) * (nb > n ? nb : n));
+	for (int i = 0; i < (nb > n ? nb : n); i++) {
+		x[i] = i < nb ? b[i] : 0;
+	}
+	coeff_t inv = lc_inverse(f, n, F);
+	reduce_p(NULL, x, nb - 1, g, n, inv, F);
+	coeff_t *r = result->coefficients;
+	r[0] = 1;
+
+	/* find highest set bit, then square and multiply from the top down */
+	long long bit = 1;
+	while (bit <= exp / 2) {
+		bit <<= 1;
+	}
+	for (; exp > 0 && bit > 0; bit >>= 1) {
+		mul_mod(r, r, r, g, n, f_inv, inv, F);
+		if (exp & bit) {
+			mul_mod(r, r, x, g, n, f_inv, inv, F);
+		}
+	}
+
+	free(x);
+	free(b);
+	free(f_inv);
+	free(g);
+
+	cache_lc(result);
+	return result;
 }
 
-/** Returns the actual degree of a polynomial. */
-int degree(Polynomial *p)
+/* --- utility functions -----------------------------------------------------*/
+
+/** Reduces r, of degree deg_r, in place modulo f, of degree n, writing the
+ * deg_r - n + 1 coefficients of the quotient to q unless it is NULL.
+ * Coefficients of both should already be in Z_m, and inv should be the inverse
+ * of f[n]. */
+void reduce_p(coeff_t *q, coeff_t *r, int deg_r, coeff_t *f, int n,
+		coeff_t inv, Field *F)
 {
-	for (int i = p->degree; i >= 0; i--) {
-		if (p->coefficients[i] != 0) {
-			return i;
+	coeff_t factor;
+
+	for (int i = deg_r; i >= n; i--) {
+		if (r[i] == 0) {
+			if (q) {
+				q[i - n] = 0;
+			}
+			continue;
+		}
+		/* r = r - (r_i / lc(f)) * x^(i-n) * f */
+		factor = field_mul(F, r[i], inv);
+		if (q) {
+			q[i - n] = factor;
+		}
+		factor = field_neg(F, factor);
+		for (int j = 0; j <= n; j++) {
+			r[i - n + j] = field_mul_add(F, r[i - n + j], factor, f[j]);
 		}
 	}
-	return 0;
 }
 
-/** Checks if a polynomial is the zero polynomial */
-int is_zero(Polynomial *p)
+/** Records the top coefficient of p as its leading coefficient if it is
+ * non-zero. Coefficients of p should already be in Z_m. */
+void cache_lc(Polynomial *p)
+{
+	p->lc = p->degree >= 0 ? p->coefficients[p->degree] : 0;
+	p->lc_inv = p->lc == 1 ? 1 : 0;
+}
+
+/** Returns the inverse of the coefficient of x^n in p, which should be its
+ * leading coefficient, from the cache if it is there */
+coeff_t lc_inverse(Polynomial *p, int n, Field *F)
+{
+	if (is_normalized(p) && p->degree == n && p->lc_inv != 0) {
+		return p->lc_inv;
+	}
+	return field_inv(F, field_elem(F, p->coefficients[n]));
+}
+
+/** Copies the coefficients of p into a, in Z_m, and returns its actual degree,
+ * or -1 if it is zero */
+int reduced_copy(coeff_t *a, Polynomial *p, Field *F)
 {
+	int d = -1;
 	for (int i = 0; i <= p->degree; i++) {
-		if (p->coefficients[i] != 0) {
-			return FALSE;
+		a[i] = field_elem(F, p->coefficients[i]);
+		if (a[i] != 0) {
+			d = i;
+		}
+	}
+	return d;
+}
+
+/** Copies the coefficients of p into Z_m, up to its actual degree, writing how
+ * many there are to n */
+coeff_t *reduced_coefficients(Polynomial *p, int *n, Field *F)
+{
+	int d = p->degree;
+	while (d > 0 && field_elem(F, p->coefficients[d]) == 0) {
+		d--;
+	}
+	*n = d + 1;
+
+	coeff_t *a = malloc(sizeof(coeff_t) * *n);
+	for (int i = 0; i < *n; i++) {
+		a[i] = field_elem(F, p->coefficients[i]);
+	}
+	return a;
+}
+
+/** Returns the na + nb - 1 coefficients of a * b, with the transform if both
+ * are large, else allocating all the scratch space the recursion needs up
+ * front */
+coeff_t *product(coeff_t *a, int na, coeff_t *b, int nb, Field *F)
+{
+	coeff_t *r = malloc(sizeof(coeff_t) * (na + nb - 1));
+	int min = na < nb ? na : nb;
+	int threshold = ntt_native(na + nb - 1, F) ? NTT_THRESHOLD
+		: NTT_CRT_THRESHOLD;
+	if (min >= threshold) {
+		ntt_mul(r, a, na, b, nb, F);
+		return r;
+	}
+
+	size_t size = scratch_size(na, nb, F);
+	coeff_t *scratch = size ? malloc(sizeof(coeff_t) * size) : NULL;
+
+	mul_coeffs(r, a, na, b, nb, scratch, F);
+
+	free(scratch);
+	return r;
+}
+
+/** Writes the na + nb - 1 coefficients of a * b to r, which must not overlap a
+ * or b. Picks schoolbook, Karatsuba or Toom-3 from the sizes, and splits
+ * unbalanced products into balanced ones. */
+void mul_coeffs(coeff_t *r, coeff_t *a, int na, coeff_t *b, int nb,
+		coeff_t *scratch, Field *F)
+{
+	if (na < nb) {
+		mul_coeffs(r, b, nb, a, na, scratch, F);
+		return;
+	}
+
+	if (nb < KARATSUBA_THRESHOLD) {
+		schoolbook(r, a, na, b, nb, F);
+	} else if (na > nb) {
+		/* multiply b by nb long blocks of a, and add the products in */
+		coeff_t *t = scratch;
+		int len;
+		for (int i = 0; i < na + nb - 1; i++) {
+			r[i] = 0;
+		}
+		for (int off = 0; off < na; off += nb) {
+			len = na - off < nb ? na - off : nb;
+			mul_coeffs(t, a + off, len, b, nb, scratch + 2 * nb - 1, F);
+			for (int i = 0; i < len + nb - 1; i++) {
+				r[off + i] = field_add(F, r[off + i], t[i]);
+			}
+		}
+	} else if (na >= TOOM3_THRESHOLD && F->prime > 3) {
+		/* Toom-3 divides by 2 and 3 */
+		toom3(r, a, b, na, scratch, F);
+	} else {
+		karatsuba(r, a, b, na, scratch, F);
+	}
+}
+
+/** r = a * b, one product at a time */
+void schoolbook(coeff_t *r, coeff_t *a, int na, coeff_t *b, int nb, Field *F)
+{
+	for (int i = 0; i < na + nb - 1; i++) {
+		r[i] = 0;
+	}
+	for (int i = 0; i < na; i++) {
+		if (a[i] == 0) {
+			continue;
+		}
+		for (int j = 0; j < nb; j++) {
+			r[i + j] = field_mul_add(F, r[i + j], a[i], b[j]);
 		}
 	}
-	return TRUE;
+}
+
+/** r = a * b for a and b with n coefficients each, from three products of half
+ * the size: with a = a0 + a1*x^m and the same for b,
+ * a*b = z0 + ((a0 + a1)(b0 + b1) - z0 - z2)*x^m + z2*x^2m. Uses 4*ceil(n/2) - 1
+ * entries of scratch, plus what the half size products need. */
+void karatsuba(coeff_t *r, coeff_t *a, coeff_t *b, int n, coeff_t *scratch,
+		Field *F)
+{
+	int m = n / 2;
+	int h = n - m;
+	coeff_t *sa = scratch;
+	coeff_t *sb = sa + h;
+	coeff_t *z1 = sb + h;
+	coeff_t *rest = z1 + 2 * h - 1;
+
+	/* z0 and z2 go straight into r, which they fill apart from r[2m-1] */
+	mul_coeffs(r, a, m, b, m, rest, F);
+	r[2 * m - 1] = 0;
+	mul_coeffs(r + 2 * m, a + m, h, b + m, h, rest, F);
+
+	for (int i = 0; i < h; i++) {
+		sa[i] = i < m ? field_add(F, a[i], a[m + i]) : a[m + i];
+		sb[i] = i < m ? field_add(F, b[i], b[m + i]) : b[m + i];
+	}
+	mul_coeffs(z1, sa, h, sb, h, rest, F);
+
+	for (int i = 0; i < 2 * m - 1; i++) {
+		z1[i] = field_sub(F, z1[i], r[i]);
+	}
+	for (int i = 0; i < 2 * h - 1; i++) {
+		z1[i] = field_sub(F, z1[i], r[2 * m + i]);
+		r[m + i] = field_add(F, r[m + i], z1[i]);
+	}
+}
+
+/** r = a * b for a and b with n coefficients each, from five products of a
+ * third of the size. Each operand is cut into three parts, seen as a quadratic
+ * in y = x^k, and the product is found from its values at 0, 1, -1, -2 and
+ * infinity with Bodrato's interpolation sequence. Uses 8*ceil(n/3) - 3 entries
+ * of scratch, plus what the smaller products need. */
+void toom3(coeff_t *r, coeff_t *a, coeff_t *b, int n, coeff_t *scratch,
+		Field *F)
+{
+	int k = (n + 2) / 3;
+	int l = n - 2 * k; /* length of the top parts */
+	coeff_t *ea = scratch;
+	coeff_t *eb = ea + k;
+	coeff_t *r1 = eb + k;
+	coeff_t *rm1 = r1 + 2 * k - 1;
+	coeff_t *rm2 = rm1 + 2 * k - 1;
+	coeff_t *rest = rm2 + 2 * k - 1;
+
+	/* values at 0 and infinity go straight into their places in r */
+	mul_coeffs(r, a, k, b, k, rest, F);
+	mul_coeffs(r + 4 * k, a + 2 * k, l, b + 2 * k, l, rest, F);
+	for (int i = 2 * k - 1; i < 4 * k; i++) {
+		r[i] = 0;
+	}
+
+	toom3_eval(ea, a, k, l, 1, F);
+	toom3_eval(eb, b, k, l, 1, F);
+	mul_coeffs(r1, ea, k, eb, k, rest, F);
+	toom3_eval(ea, a, k, l, F->p - 1, F);
+	toom3_eval(eb, b, k, l, F->p - 1, F);
+	mul_coeffs(rm1, ea, k, eb, k, rest, F);
+	toom3_eval(ea, a, k, l, F->p - 2, F);
+	toom3_eval(eb, b, k, l, F->p - 2, F);
+	mul_coeffs(rm2, ea, k, eb, k, rest, F);
+
+	coeff_t inv2 = field_inv(F, 2);
+	coeff_t inv3 = field_inv(F, 3);
+	coeff_t v0, vinf, c1, c2, c3;
+	for (int i = 0; i < 2 * k - 1; i++) {
+		v0 = r[i];
+		vinf = i < 2 * l - 1 ? r[4 * k + i] : 0;
+
+		c3 = field_mul(F, field_sub(F, rm2[i], r1[i]), inv3);
+		c1 = field_mul(F, field_sub(F, r1[i], rm1[i]), inv2);
+		c2 = field_sub(F, rm1[i], v0);
+		c3 = field_add(F, field_mul(F, field_sub(F, c2, c3), inv2),
+				field_add(F, vinf, vinf));
+		c2 = field_sub(F, field_add(F, c2, c1), vinf);
+		c1 = field_sub(F, c1, c3);
+
+		/* keep the coefficients of y, y^2 and y^3 until r0 has been read */
+		r1[i] = c1;
+		rm1[i] = c2;
+		rm2[i] = c3;
+	}
+
+	int len = 2 * n - 1;
+	for (int i = 0; i < 2 * k - 1; i++) {
+		r[k + i] = field_add(F, r[k + i], r1[i]);
+		r[2 * k + i] = field_add(F, r[2 * k + i], rm1[i]);
+		if (3 * k + i < len) {
+			r[3 * k + i] = field_add(F, r[3 * k + i], rm2[i]);
+		}
+	}
+}
+
+/** e = a0 + point * a1 + point^2 * a2, where a0 and a1 have k coefficients and
+ * a2 has l */
+void toom3_eval(coeff_t *e, coeff_t *a, int k, int l, coeff_t point, Field *F)
+{
+	coeff_t square = field_mul(F, point, point);
+	for (int i = 0; i < k; i++) {
+		e[i] = field_mul_add(F, a[i], point, a[k + i]);
+		if (i < l) {
+			e[i] = field_mul_add(F, e[i], square, a[2 * k + i]);
+		}
+	}
+}
+
+/** Returns how many entries of scratch mul_coeffs needs for a product of na
+ * and nb coefficients, following the same choices it makes */
+size_t scratch_size(int na, int nb, Field *F)
+{
+	size_t s, t;
+	if (na < nb) {
+		return scratch_size(nb, na, F);
+	}
+
+	if (nb < KARATSUBA_THRESHOLD) {
+		return 0;
+	} else if (na > nb) {
+		s = scratch_size(nb, nb, F);
+		if (na % nb) {
+			t = scratch_size(na % nb, nb, F);
+			s = t > s ? t : s;
+		}
+		return 2 * nb - 1 + s;
+	} else if (na >= TOOM3_THRESHOLD && F->prime > 3) {
+		int k = (na + 2) / 3;
+		s = scratch_size(k, k, F);
+		t = scratch_size(na - 2 * k, na - 2 * k, F);
+		return 8 * k - 3 + (t > s ? t : s);
+	}
+
+	int h = na - na / 2;
+	s = scratch_size(h, h, F);
+	t = scratch_size(na / 2, na / 2, F);
+	return 4 * h - 1 + (t > s ? t : s);
+}
+
+/** Returns the first len coefficients of the power series 1 / g, where g has ng
+ * coefficients and g[0] is non-zero. Newton's iteration h = h * (2 - g * h)
+ * doubles the number of correct coefficients each time. */
+coeff_t *series_inverse(coeff_t *g, int ng, int len, Field *F)
+{
+	coeff_t *h = malloc(sizeof(coeff_t) * (len > 0 ? len : 1));
+	coeff_t *e = malloc(sizeof(coeff_t) * (len > 0 ? len : 1));
+	h[0] = field_inv(F, g[0]);
+	coeff_t *gh, *t;
+
+	for (int k = 1; k < len; k *= 2) {
+		int next = 2 * k < len ? 2 * k : len;
+
+		/* e = 2 - g * h mod x^next, where g * h may stop short of next
+		 * coefficients if g is short, as g is zero past ng */
+		int m = ng < next ? ng : next;
+		gh = product(g, m, h, k, F);
+		for (int i = 0; i < next; i++) {
+			e[i] = i < m + k - 1 ? field_neg(F, gh[i]) : 0;
+		}
+		e[0] = field_add(F, e[0], field_elem(F, 2));
+		free(gh);
+
+		t = product(h, k, e, next, F);
+		for (int i = 0; i < next; i++) {
+			h[i] = t[i];
+		}
+		free(t);
+	}
+
+	free(e);
+	return h;
+}
+
+/** r = a * b mod f, where f has degree n and a, b and r have n coefficients.
+ * r may be the same as a or b. If f_inv holds the first n - 1 coefficients of
+ * 1 / rev(f), the quotient is found with two more products as in Barrett's
+ * method, otherwise by long division. */
+void mul_mod(coeff_t *r, coeff_t *a, coeff_t *b, coeff_t *f, int n,
+		coeff_t *f_inv, coeff_t inv, Field *F)
+{
+	coeff_t *prod = product(a, n, b, n, F);
+	int len = 2 * n - 1;
+
+	if (!f_inv) {
+		reduce_p(NULL, prod, len - 1, f, n, inv, F);
+		for (int i = 0; i < n; i++) {
+			r[i] = prod[i];
+		}
+		free(prod);
+		return;
+	}
+
+	/* the quotient has m = n - 1 coefficients, and reversed it is the top of
+	 * the product reversed times 1 / rev(f), mod x^m */
+	int m = len - n;
+	coeff_t *top = malloc(sizeof(coeff_t) * m);
+	for (int i = 0; i < m; i++) {
+		top[i] = prod[len - 1 - i];
+	}
+	coeff_t *q_rev = product(top, m, f_inv, m, F);
+	for (int i = 0; i < m; i++) {
+		top[i] = q_rev[m - 1 - i];
+	}
+
+	/* r = prod - q * f, of which only the lowest n coefficients are left */
+	coeff_t *qf = product(top, m, f, n + 1, F);
+	for (int i = 0; i < n; i++) {
+		r[i] = field_sub(F, prod[i], qf[i]);
+	}
+
+	free(qf);
+	free(q_rev);
+	free(top);
+	free(prod);
+}
+
+/* Polynomials in the gcd functions below are kept trimmed, with coefficients in
+ * Z_m and degree the actual degree, or -1 for the zero polynomial. */
+
+/** The gcd of p1 and p2, and if s and t are given, cofactors with
+ * s * p1 + t * p2 = gcd. Runs the remainder sequence one division at a time
+ * while the degrees are below GCD_THRESHOLD, and above it jumps over half of
+ * the remaining quotients at once with half_gcd. */
+Polynomial *fast_gcd(Polynomial **s, Polynomial **t, Polynomial *p1,
+		Polynomial *p2, Field *F)
+{
+	Polynomial *a = trimmed(p1, F);
+	Polynomial *b = trimmed(p2, F);
+	Polynomial *c, *d, *q, *r;
+	GcdMatrix *T = s ? init_gcd_matrix() : NULL;
+	GcdMatrix *M, *helper;
+
+	while (b->degree >= 0) {
+		if (b->degree >= GCD_THRESHOLD && a->degree > b->degree) {
+			M = half_gcd(&c, &d, a, b, F);
+			free_polynomial(a);
+			free_polynomial(b);
+			a = c;
+			b = d;
+			if (T) {
+				helper = matrix_product(M, T, F);
+				free_gcd_matrix(T);
+				T = helper;
+			}
+			free_gcd_matrix(M);
+			if (b->degree < 0) {
+				break;
+			}
+		}
+
+		/* one step of the remainder sequence, (a, b) = (b, a mod b) */
+		divide(&q, &r, a, b, F);
+		if (T) {
+			matrix_step(T, q, F);
+		}
+		free_polynomial(q);
+		free_polynomial(a);
+		a = b;
+		b = r;
+	}
+	free_polynomial(b);
+
+	if (T) {
+		*s = finished(T->m[0][0]);
+		*t = finished(T->m[0][1]);
+		free_polynomial(T->m[1][0]);
+		free_polynomial(T->m[1][1]);
+		free(T);
+	}
+
+	return finished(a);
+}
+
+/** For deg(a) > deg(b), returns a matrix M of Euclid steps such that
+ * (c, d) = M (a, b) has deg(c) >= k > deg(d), where k = ceil((deg(a) + 1) / 2),
+ * and writes c and d. The quotients of the first half of the remainder
+ * sequence depend only on the top halves of a and b, so they are found by
+ * recursing on those, and the rest of the way is made up with one division and
+ * a second recursion. */
+GcdMatrix *half_gcd(Polynomial **c, Polynomial **d, Polynomial *a,
+		Polynomial *b, Field *F)
+{
+	int k = (a->degree + 1) / 2;
+	GcdMatrix *M = init_gcd_matrix();
+	Polynomial *q, *r;
+	*c = trimmed(a, F);
+	*d = trimmed(b, F);
+	if (b->degree < k) {
+		return M;
+	}
+
+	if (a->degree < HALF_GCD_THRESHOLD) {
+		/* small enough to run the remainder sequence directly */
+		while ((*d)->degree >= k) {
+			divide(&q, &r, *c, *d, F);
+			matrix_step(M, q, F);
+			free_polynomial(q);
+			free_polynomial(*c);
+			*c = *d;
+			*d = r;
+		}
+		return M;
+	}
+	free_gcd_matrix(M);
+	free_polynomial(*c);
+	free_polynomial(*d);
+
+	/* first half, from the top halves of a and b */
+	Polynomial *a_top = shift_down(a, k);
+	Polynomial *b_top = shift_down(b, k);
+	M = half_gcd(c, d, a_top, b_top, F);
+	add_low_part(c, d, M, a, b, k, F);
+	free_polynomial(a_top);
+	free_polynomial(b_top);
+
+	if ((*d)->degree < k) {
+		return M;
+	}
+
+	/* one division, then the second half from the tops of what is left */
+	divide(&q, &r, *c, *d, F);
+	matrix_step(M, q, F);
+	free_polynomial(q);
+	free_polynomial(*c);
+	*c = *d;
+	*d = r;
+	if ((*d)->degree < k) {
+		return M;
+	}
+
+	int j = 2 * k - (*c)->degree;
+	Polynomial *c_top = shift_down(*c, j);
+	Polynomial *d_top = shift_down(*d, j);
+	Polynomial *e, *f;
+	GcdMatrix *N = half_gcd(&e, &f, c_top, d_top, F);
+	add_low_part(&e, &f, N, *c, *d, j, F);
+	free_polynomial(c_top);
+	free_polynomial(d_top);
+	free_polynomial(*c);
+	free_polynomial(*d);
+	*c = e;
+	*d = f;
+
+	GcdMatrix *helper = matrix_product(N, M, F);
+	free_gcd_matrix(M);
+	free_gcd_matrix(N);
+	return helper;
+}
+
+/** Given (c, d) = M (a div x^k, b div x^k), replaces them with M (a, b), by
+ * adding on M applied to the k lowest coefficients of a and b. This needs
+ * smaller products than applying M to a and b from scratch. */
+void add_low_part(Polynomial **c, Polynomial **d, GcdMatrix *M, Polynomial *a,
+		Polynomial *b, int k, Field *F)
+{
+	Polynomial *a_low = low_part(a, k, F);
+	Polynomial *b_low = low_part(b, k, F);
+	Polynomial *top[2] = {*c, *d};
+	Polynomial *sum[2];
+
+	for (int i = 0; i < 2; i++) {
+		Polynomial *low = combine(M->m[i][0], a_low, M->m[i][1], b_low, F);
+		int deg = top[i]->degree >= 0 ? top[i]->degree + k : -1;
+		deg = deg > low->degree ? deg : low->degree;
+		sum[i] = init_polynomial(deg >= 0 ? deg : 0);
+		for (int j = 0; j <= low->degree; j++) {
+			sum[i]->coefficients[j] = low->coefficients[j];
+		}
+		for (int j = 0; j <= top[i]->degree; j++) {
+			sum[i]->coefficients[j + k] = field_add(F,
+					sum[i]->coefficients[j + k], top[i]->coefficients[j]);
+		}
+		sum[i]->degree = deg;
+		while (sum[i]->degree >= 0
+				&& sum[i]->coefficients[sum[i]->degree] == 0) {
+			sum[i]->degree--;
+		}
+		free_polynomial(low);
+		free_polynomial(top[i]);
+	}
+
+	free_polynomial(a_low);
+	free_polynomial(b_low);
+	*c = sum[0];
+	*d = sum[1];
+}
+
+/** Returns the identity matrix */
+GcdMatrix *init_gcd_matrix(void)
+{
+	GcdMatrix *M = malloc(sizeof(GcdMatrix));
+	for (int i = 0; i < 2; i++) {
+		for (int j = 0; j < 2; j++) {
+			M->m[i][j] = init_polynomial(0);
+			M->m[i][j]->coefficients[0] = i == j;
+			M->m[i][j]->degree = i == j ? 0 : -1;
+		}
+	}
+	return M;
+}
+
+/** Frees a matrix and its entries */
+void free_gcd_matrix(GcdMatrix *M)
+{
+	for (int i = 0; i < 2; i++) {
+		for (int j = 0; j < 2; j++) {
+			free_polynomial(M->m[i][j]);
+		}
+	}
+	free(M);
+}
+
+/** Returns the matrix product M N */
+GcdMatrix *matrix_product(GcdMatrix *M, GcdMatrix *N, Field *F)
+{
+	GcdMatrix *P = malloc(sizeof(GcdMatrix));
+	for (int i = 0; i < 2; i++) {
+		for (int j = 0; j < 2; j++) {
+			P->m[i][j] = combine(M->m[i][0], N->m[0][j], M->m[i][1],
+					N->m[1][j], F);
+		}
+	}
+	return P;
+}
+
+/** Replaces M with (0 1; 1 -q) M, the step from (a, b) to (b, a - q b) */
+void matrix_step(GcdMatrix *M, Polynomial *q, Field *F)
+{
+	for (int j = 0; j < 2; j++) {
+		Polynomial *top = M->m[0][j];
+		Polynomial *bottom = M->m[1][j];
+		int d = bottom->degree >= 0 ? bottom->degree + q->degree : -1;
+		d = d > top->degree ? d : top->degree;
+
+		Polynomial *next = init_polynomial(d >= 0 ? d : 0);
+		for (int i = 0; i <= top->degree; i++) {
+			next->coefficients[i] = top->coefficients[i];
+		}
+		if (bottom->degree >= 0) {
+			coeff_t *prod = product(bottom->coefficients, bottom->degree + 1,
+					q->coefficients, q->degree + 1, F);
+			for (int i = 0; i <= bottom->degree + q->degree; i++) {
+				next->coefficients[i] = field_sub(F, next->coefficients[i],
+						prod[i]);
+			}
+			free(prod);
+		}
+
+		next->degree = d;
+		while (next->degree >= 0 && next->coefficients[next->degree] == 0) {
+			next->degree--;
+		}
+		M->m[0][j] = bottom;
+		M->m[1][j] = next;
+		free_polynomial(top);
+	}
+}
+
+/** Division with remainder of a by a non-zero b, for trimmed polynomials */
+void divide(Polynomial **q, Polynomial **r, Polynomial *a, Polynomial *b,
+		Field *F)
+{
+	int db = b->degree;
+	*r = trimmed(a, F);
+	*q = init_polynomial(a->degree >= db ? a->degree - db : 0);
+	if (a->degree < db) {
+		(*q)->degree = -1;
+		return;
+	}
+
+	reduce_p((*q)->coefficients, (*r)->coefficients, a->degree,
+			b->coefficients, db, field_inv(F, b->coefficients[db]), F);
+	(*r)->degree = db - 1;
+	while ((*r)->degree >= 0 && (*r)->coefficients[(*r)->degree] == 0) {
+		(*r)->degree--;
+	}
+}
+
+/** Returns a trimmed copy of p with its coefficients in Z_m */
+Polynomial *trimmed(Polynomial *p, Field *F)
+{
+	int d = p->degree;
+	while (d >= 0 && field_elem(F, p->coefficients[d]) == 0) {
+		d--;
+	}
+
+	Polynomial *t = init_polynomial(d >= 0 ? d : 0);
+	t->degree = d;
+	for (int i = 0; i <= d; i++) {
+		t->coefficients[i] = field_elem(F, p->coefficients[i]);
+	}
+	return t;
+}
+
+/** Returns p div x^k, dropping the k lowest coefficients */
+Polynomial *shift_down(Polynomial *p, int k)
+{
+	int d = p->degree - k;
+	Polynomial *s = init_polynomial(d >= 0 ? d : 0);
+	s->degree = d >= 0 ? d : -1;
+	for (int i = 0; i <= d; i++) {
+		s->coefficients[i] = p->coefficients[i + k];
+	}
+	return s;
+}
+
+/** Returns p mod x^k, trimmed */
+Polynomial *low_part(Polynomial *p, int k, Field *F)
+{
+	int d = p->degree < k ? p->degree : k - 1;
+	while (d >= 0 && p->coefficients[d] == 0) {
+		d--;
+	}
+
+	Polynomial *l = init_polynomial(d >= 0 ? d : 0);
+	l->degree = d;
+	for (int i = 0; i <= d; i++) {
+		l->coefficients[i] = field_elem(F, p->coefficients[i]);
+	}
+	return l;
+}
+
+/** Returns a * x + b * y */
+Polynomial *combine(Polynomial *a, Polynomial *x, Polynomial *b,
+		Polynomial *y, Field *F)
+{
+	int d1 = a->degree >= 0 && x->degree >= 0 ? a->degree + x->degree : -1;
+	int d2 = b->degree >= 0 && y->degree >= 0 ? b->degree + y->degree : -1;
+	int d = d1 > d2 ? d1 : d2;
+	Polynomial *c = init_polynomial(d >= 0 ? d : 0);
+	coeff_t *prod;
+
+	if (d1 >= 0) {
+		prod = product(a->coefficients, a->degree + 1, x->coefficients,
+				x->degree + 1, F);
+		for (int i = 0; i <= d1; i++) {
+			c->coefficients[i] = prod[i];
+		}
+		free(prod);
+	}
+	if (d2 >= 0) {
+		prod = product(b->coefficients, b->degree + 1, y->coefficients,
+				y->degree + 1, F);
+		for (int i = 0; i <= d2; i++) {
+			c->coefficients[i] = field_add(F, c->coefficients[i], prod[i]);
+		}
+		free(prod);
+	}
+
+	c->degree = d;
+	while (c->degree >= 0 && c->coefficients[c->degree] == 0) {
+		c->degree--;
+	}
+	return c;
+}
+
+/** Turns a trimmed polynomial back into the usual form, where zero has degree
+ * 0, with its leading coefficient cached */
+Polynomial *finished(Polynomial *p)
+{
+	if (p->degree < 0) {
+		p->degree = 0;
+		p->coefficients[0] = 0;
+	}
+	cache_lc(p);
+	return p;
 }
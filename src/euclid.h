@@ -7,14 +7,54 @@
 #ifndef EUCLID
 #define EUCLID
 
+#include <stdio.h>
+#include "field.h"
+
 #define FALSE 0
 #define TRUE 1
 
+/* Number of coefficients from which poly_mul switches from schoolbook to
+ * Karatsuba, and from Karatsuba to Toom-3 */
+#define KARATSUBA_THRESHOLD 16
+#define TOOM3_THRESHOLD 96
+
+/* Degree from which gcd_p uses the half gcd algorithm, and below which the half
+ * gcd algorithm runs the remainder sequence directly instead of recursing */
+#define GCD_THRESHOLD 2048
+#define HALF_GCD_THRESHOLD 256
+
+/* Degree of the modulus from which pow_mod_p divides by multiplying with a
+ * precomputed inverse, rather than by long division */
+#define DIVISION_THRESHOLD 128
+
+/* The degree is the highest power with room in coefficients, and may be above
+ * the actual degree. The kernels below record the leading coefficient of each
+ * polynomial they produce in lc whenever its top coefficient is non-zero, so
+ * that the actual degree can be read off without a scan, and its inverse in
+ * lc_inv once that has been needed. Both are 0 when not known. The cache checks
+ * itself against the top coefficient (see is_normalized), so writing to the
+ * coefficients directly never leaves it wrong. */
 typedef struct polynomial {
 	int degree;
-	int *coefficients;
+	coeff_t *coefficients;
+	coeff_t lc;     /* coefficients[degree], in Z_m and non-zero, or 0 */
+	coeff_t lc_inv; /* the inverse of lc in Z_m, or 0 */
 } Polynomial;
 
+/**
+ * Checks whether the degree of a polynomial is known to be its actual degree,
+ * from the leading coefficient cached with it. This costs one comparison.
+ *
+ * @param[in] p
+ *     pointer to the polynomial
+ * @return    TRUE if p->degree is the actual degree and p->lc its leading
+ *            coefficient, else FALSE
+ */
+static inline int is_normalized(Polynomial *p)
+{
+	return p->lc != 0 && p->coefficients[p->degree] == p->lc;
+}
+
 /* INTEGERS */
 
 /** 
@@ -62,6 +102,16 @@ void free_polynomial(Polynomial *polynomial);
  */
 void print_polynomial(Polynomial *polynomial);
 
+/**
+ * Prints a polynomial to a stream, in the same form as print_polynomial.
+ *
+ * @param[in] stream
+ *     the stream to print to
+ * @param[in] polynomial
+ *     pointer to the polynomial which should be printed
+ */
+void fprint_polynomial(FILE *stream, Polynomial *polynomial);
+
 /**
  * Allocates memory for and returns a polynomial. Initializes all its 
  * coefficients to zero.
@@ -81,6 +131,19 @@ Polynomial *init_polynomial(int degree);
  */
 Polynomial *copy_polynomial(Polynomial *poly);
 
+/**
+ * Normalizes a polynomial in place: its coefficients are reduced into Z_m, its
+ * degree is lowered to its actual degree, and its leading coefficient and the
+ * inverse of that are cached. The zero polynomial is left as the constant 0.
+ *
+ * @param[in] p
+ *     pointer to the polynomial to be normalized
+ * @param[in] F
+ *     the field Z_m, where m is prime
+ * @return    the actual degree of p, or 0 if it is zero
+ */
+int normalize_p(Polynomial *p, Field *F);
+
 /**
  * Scans for the degree of a polynomial, then allocates memory for a new
  * polynomial, scans in all its coefficients and finally returns a pointer to it.
@@ -89,6 +152,18 @@ Polynomial *copy_polynomial(Polynomial *poly);
  */
 Polynomial *scan_polynomial(void);
 
+/**
+ * Reads a polynomial from a stream without prompting for it, as its degree
+ * followed by its coefficients from lowest order term to highest, all separated
+ * by whitespace.
+ *
+ * @param[in] stream
+ *     the stream to read from
+ * @return    the polynomial read, or NULL at the end of the stream or if what
+ *            was there is not a polynomial
+ */
+Polynomial *read_polynomial(FILE *stream);
+
 /**
  * Gets the formal derivative. Calculated the same way that we are used to for
  * polynomials, just a different name because we can't use limits when working
@@ -96,11 +171,24 @@ Polynomial *scan_polynomial(void);
  *
  * @param[in] p
  *     the polynomial whose derivative should be calculated
- * @param[in] m
- *     prime number so that we can ensure coefficients are in Z_m
+ * @param[in] F
+ *     the field Z_m, so that we can ensure coefficients are in Z_m
  * @return    the formal derivative of p
  */
-Polynomial *get_formal_derivative(Polynomial *p, int m);
+Polynomial *get_formal_derivative(Polynomial *p, Field *F);
+
+/**
+ * Gets the formal derivative, as get_formal_derivative, without allocating.
+ *
+ * @param[out] d
+ *     where the derivative should be written, with room for the degree of p
+ *     plus one coefficients
+ * @param[in]  p
+ *     the polynomial whose derivative should be calculated
+ * @param[in]  F
+ *     the field Z_m, so that we can ensure coefficients are in Z_m
+ */
+void get_formal_derivative_into(Polynomial *d, Polynomial *p, Field *F);
 
 /** 
  * Euclidean division of polynomial 1 by polynomial 2 over a finite field (Z_m, 
@@ -114,23 +202,186 @@ Polynomial *get_formal_derivative(Polynomial *p, int m);
  *     pointer to the dividend
  * @param[in] p2
  *     pointer to the divisor
- * @param[in] m
- *     prime number so that we can work with field Z_m
+ * @param[in] F
+ *     the field Z_m, where m is prime
  */
 void long_div(Polynomial **q, Polynomial **r, Polynomial *p1, Polynomial *p2,
-		int m);
+		Field *F);
 
 /**
- * Euclid's algorithm for calculating the gcd of 2 polynomials.
+ * Euclidean division, as long_div, into polynomials the caller has already
+ * allocated. Nothing is allocated. The quotient and remainder are left with
+ * their actual degrees.
+ *
+ * @param[out] q
+ *     where the quotient should be written, with room for deg(p1) - deg(p2) + 1
+ *     coefficients
+ * @param[out] r
+ *     where the remainder should be written, with room for the degree of p1
+ *     plus one coefficients. May be p1 itself.
+ * @param[in]  p1
+ *     pointer to the dividend
+ * @param[in]  p2
+ *     pointer to the divisor, whose coefficients must already be in Z_m
+ * @param[in]  F
+ *     the field Z_m, where m is prime
+ */
+void long_div_into(Polynomial *q, Polynomial *r, Polynomial *p1,
+		Polynomial *p2, Field *F);
+
+/**
+ * The remainder of Euclidean division, as from long_div, without the quotient.
+ * For f of degree DIVISION_THRESHOLD or more, the quotient is found by
+ * multiplying the top of p by the inverse of f reversed as a power series, so
+ * the division costs a few products rather than O(deg(p) deg(f)) operations.
+ * Works over Z_(p^k) too if f is monic.
+ *
+ * @param[in] p
+ *     pointer to the dividend
+ * @param[in] f
+ *     pointer to the (non-zero) divisor
+ * @param[in] F
+ *     the field Z_m, where m is prime
+ * @return    p mod f, with degree one less than that of f
+ */
+Polynomial *rem_p(Polynomial *p, Polynomial *f, Field *F);
+
+/**
+ * Euclid's algorithm for calculating the gcd of 2 polynomials. Once the degrees
+ * reach GCD_THRESHOLD, half of the remaining remainder sequence is skipped at a
+ * time with the half gcd algorithm, which finds the quotients from the top
+ * halves of the polynomials, so large gcds cost O(M(d) log d) rather than
+ * O(d^2). The gcd is only determined up to a constant factor.
  * 
  * @param[in] p1
  *     pointer to the first polynomial
  * @param[in] p2
  *     pointer to the second polynomial
- * @param[in] m
- *     prime number, so we work with field Z_m
+ * @param[in] F
+ *     the field Z_m, where m is prime
  * @return    the gcd of polynomials p1 and p2
  */
-Polynomial *gcd_p(Polynomial *p1, Polynomial *p2, int m);
+Polynomial *gcd_p(Polynomial *p1, Polynomial *p2, Field *F);
+
+/**
+ * The extended Euclidean algorithm for polynomials, done in the same way as
+ * gcd_p. Also finds Bezout cofactors s and t with s * p1 + t * p2 = gcd.
+ *
+ * @param[out] s
+ *     pointer to where the cofactor of p1 should be written
+ * @param[out] t
+ *     pointer to where the cofactor of p2 should be written
+ * @param[in]  p1
+ *     pointer to the first polynomial
+ * @param[in]  p2
+ *     pointer to the second polynomial
+ * @param[in]  F
+ *     the field Z_m, where m is prime
+ * @return     the gcd of polynomials p1 and p2, the same as from gcd_p
+ */
+Polynomial *ext_gcd_p(Polynomial **s, Polynomial **t, Polynomial *p1,
+		Polynomial *p2, Field *F);
+
+/**
+ * Euclid's algorithm, as gcd_p, into a polynomial the caller has already
+ * allocated. The remainder sequence is run in place in work, so nothing is
+ * allocated unless both degrees reach GCD_THRESHOLD, when gcd_p is used.
+ *
+ * @param[out] g
+ *     where the gcd should be written, with its actual degree. Needs room for
+ *     the larger degree of p1 and p2 plus one coefficients.
+ * @param[in]  p1
+ *     pointer to the first polynomial
+ * @param[in]  p2
+ *     pointer to the second polynomial
+ * @param[in]  work
+ *     scratch space for deg(p1) + deg(p2) + 2 coefficients
+ * @param[in]  F
+ *     the field Z_m, where m is prime
+ */
+void gcd_p_into(Polynomial *g, Polynomial *p1, Polynomial *p2, coeff_t *work,
+		Field *F);
+
+/**
+ * Makes a monic copy of a polynomial over Z_m, whose degree is trimmed to the
+ * actual degree so that it can be read off directly. The zero polynomial is
+ * returned as the constant 0.
+ *
+ * @param[in] p
+ *     pointer to the polynomial
+ * @param[in] F
+ *     the field Z_m, where m is prime
+ * @return    p divided by its leading coefficient
+ */
+Polynomial *monic_p(Polynomial *p, Field *F);
+
+/**
+ * Makes a polynomial monic, as monic_p, into one the caller has already
+ * allocated.
+ *
+ * @param[out] m
+ *     where the monic polynomial should be written, with room for the degree
+ *     of p plus one coefficients. May be p itself.
+ * @param[in]  p
+ *     pointer to the polynomial
+ * @param[in]  F
+ *     the field Z_m, where m is prime
+ */
+void monic_p_into(Polynomial *m, Polynomial *p, Field *F);
+
+/**
+ * Multiplies two polynomials over the finite field Z_m. Small products are done
+ * term by term, and larger ones with Karatsuba's method or Toom-3, which split
+ * the operands and recurse on fewer, smaller products. All the scratch space
+ * the recursion needs is allocated once up front. The largest products use the
+ * number theoretic transform in ntt.c.
+ *
+ * @param[in] p1
+ *     pointer to the first factor
+ * @param[in] p2
+ *     pointer to the second factor
+ * @param[in] F
+ *     the field Z_m, where m is prime
+ * @return    p1 * p2, with degree deg(p1) + deg(p2)
+ */
+Polynomial *poly_mul(Polynomial *p1, Polynomial *p2, Field *F);
+
+/**
+ * Multiplies two polynomials and reduces the product modulo a third, over the
+ * finite field Z_m. The product is formed as in poly_mul, never at a degree
+ * higher than deg(p1) + deg(p2), so this is suitable for modular
+ * exponentiation.
+ *
+ * @param[in] p1
+ *     pointer to the first factor
+ * @param[in] p2
+ *     pointer to the second factor
+ * @param[in] f
+ *     pointer to the (non-zero) polynomial we are reducing by
+ * @param[in] F
+ *     the field Z_m, where m is prime
+ * @return    p1 * p2 mod f, with degree one less than that of f
+ */
+Polynomial *mul_mod_p(Polynomial *p1, Polynomial *p2, Polynomial *f, Field *F);
+
+/**
+ * Raises a polynomial to a power modulo f, over the finite field Z_m, by
+ * repeated squaring. Only O(log(exp)) multiplications are needed, so large
+ * exponents such as m itself are cheap. For f of degree DIVISION_THRESHOLD or
+ * more, the inverse of f reversed is found once as a power series, and each
+ * reduction then costs two products instead of a long division.
+ *
+ * @param[in] base
+ *     pointer to the polynomial to be raised to a power
+ * @param[in] exp
+ *     the (non-negative) exponent
+ * @param[in] f
+ *     pointer to the (non-zero) polynomial we are reducing by
+ * @param[in] F
+ *     the field Z_m, where m is prime
+ * @return    base^exp mod f, with degree one less than that of f
+ */
+Polynomial *pow_mod_p(Polynomial *base, long long exp, Polynomial *f,
+		Field *F);
 
 #endif
@@ -0,0 +1,237 @@
+/**
+ * @file    evaluate.c
+ * @brief   Implementation of batch evaluation, with Horner's rule over blocks
+ *          of points and with remainder trees.
+ */
+
+#include <stdlib.h>
+#include "evaluate.h"
+
+/* --- type definitions ------------------------------------------------------*/
+
+typedef struct product_tree {
+	Polynomial *poly;              /* the product of x - x_i below, monic */
+	int n;                         /* the number of points below */
+	struct product_tree *left;     /* the children, both NULL for a leaf */
+	struct product_tree *right;
+} ProductTree;
+
+/* --- function prototypes ---------------------------------------------------*/
+
+static void horner(coeff_t *values, coeff_t *slopes, coeff_t *a, int d,
+		coeff_t *x, int n, Field *F);
+static ProductTree *build_tree(coeff_t *x, int n, Field *F);
+static void descend(ProductTree *T, Polynomial *f, Polynomial *d, coeff_t *x,
+		coeff_t *values, coeff_t *slopes, Field *F);
+static void free_tree(ProductTree *T);
+
+/* --- evaluate interface ----------------------------------------------------*/
+
+void evaluate_many(coeff_t *values, coeff_t *slopes, Polynomial *f,
+		coeff_t *points, int n, Field *F)
+{
+	if (n <= 0) {
+		return;
+	}
+
+	/* reduce the points and the coefficients, up to the actual degree */
+	coeff_t *x = malloc(sizeof(coeff_t) * n);
+	for (int i = 0; i < n; i++) {
+		x[i] = field_elem(F, points[i]);
+	}
+	int d = f->degree;
+	while (d > 0 && field_elem(F, f->coefficients[d]) == 0) {
+		d--;
+	}
+	Polynomial *g = init_polynomial(d);
+	for (int i = 0; i <= d; i++) {
+		g->coefficients[i] = field_elem(F, f->coefficients[i]);
+	}
+
+	int threshold = EVALUATE_TREE_THRESHOLD;
+#if !defined(WIDE_COEFFICIENTS) && (defined(__AVX2__) || defined(__SSE4_1__))
+	if (F->p % 2 == 1) {
+		threshold = EVALUATE_VECTOR_TREE_THRESHOLD;
+	}
+#endif
+	if (n < threshold || d < threshold) {
+		horner(values, slopes, g->coefficients, d, x, n, F);
+	} else {
+		/* f' is taken over the integers, so it is right mod any m, and
+		 * reduced down the tree alongside f */
+		Polynomial *g_prime = NULL;
+		if (slopes) {
+			g_prime = init_polynomial(d - 1);
+			for (int i = 0; i < d; i++) {
+				g_prime->coefficients[i] = field_mul(F, field_elem(F, i + 1),
+						g->coefficients[i + 1]);
+			}
+		}
+		ProductTree *T = build_tree(x, n, F);
+		descend(T, g, g_prime, x, values, slopes, F);
+		free_tree(T);
+		if (g_prime) {
+			free_polynomial(g_prime);
+		}
+	}
+
+	free_polynomial(g);
+	free(x);
+}
+
+/* --- utility functions -----------------------------------------------------*/
+
+/** Writes f(x_i), and f'(x_i) unless slopes is NULL, for the n points x, where
+ * f has the d + 1 coefficients a. Everything should already be in Z_m. */
+void horner(coeff_t *values, coeff_t *slopes, coeff_t *a, int d, coeff_t *x,
+		int n, Field *F)
+{
+	int i = 0;
+
+#if !defined(WIDE_COEFFICIENTS) && defined(__AVX2__)
+	if (F->p % 2 == 1) {
+		__m256i pinv = _mm256_set1_epi32((int) F->pinv);
+		__m256i p = _mm256_set1_epi32(F->p);
+		coeff_t xm[8];
+		for (; i + 8 <= n; i += 8) {
+			/* x * 2^32, so that reducing v * x * 2^32 gives v * x */
+			for (int j = 0; j < 8; j++) {
+				xm[j] = field_mul(F, x[i + j], F->r);
+			}
+			__m256i b = _mm256_loadu_si256((__m256i *) xm);
+			__m256i v = _mm256_setzero_si256();
+			__m256i s = _mm256_setzero_si256();
+			for (int k = d; k >= 0; k--) {
+				if (slopes) {
+					s = mul_add_8(v, s, b, pinv, p);
+				}
+				v = mul_add_8(_mm256_set1_epi32(a[k]), v, b, pinv, p);
+			}
+			_mm256_storeu_si256((__m256i *) (values + i), v);
+			if (slopes) {
+				_mm256_storeu_si256((__m256i *) (slopes + i), s);
+			}
+		}
+	}
+#elif !defined(WIDE_COEFFICIENTS) && defined(__SSE4_1__)
+	if (F->p % 2 == 1) {
+		__m128i pinv = _mm_set1_epi32((int) F->pinv);
+		__m128i p = _mm_set1_epi32(F->p);
+		coeff_t xm[4];
+		for (; i + 4 <= n; i += 4) {
+			for (int j = 0; j < 4; j++) {
+				xm[j] = field_mul(F, x[i + j], F->r);
+			}
+			__m128i b = _mm_loadu_si128((__m128i *) xm);
+			__m128i v = _mm_setzero_si128();
+			__m128i s = _mm_setzero_si128();
+			for (int k = d; k >= 0; k--) {
+				if (slopes) {
+					s = mul_add_4(v, s, b, pinv, p);
+				}
+				v = mul_add_4(_mm_set1_epi32(a[k]), v, b, pinv, p);
+			}
+			_mm_storeu_si128((__m128i *) (values + i), v);
+			if (slopes) {
+				_mm_storeu_si128((__m128i *) (slopes + i), s);
+			}
+		}
+	}
+#endif
+	COUNT(reductions, (unsigned long long) i * (d + 1) * (slopes ? 2 : 1));
+
+	/* whatever is left over, or everything without vector support, a block
+	 * of points at a time, with f' accumulated as f'(x) = f'(x) x + f(x) */
+	coeff_t v[EVALUATE_BLOCK], s[EVALUATE_BLOCK];
+	int len;
+	for (; i < n; i += len) {
+		len = n - i < EVALUATE_BLOCK ? n - i : EVALUATE_BLOCK;
+		for (int j = 0; j < len; j++) {
+			v[j] = 0;
+			s[j] = 0;
+		}
+		for (int k = d; k >= 0; k--) {
+			if (slopes) {
+				for (int j = 0; j < len; j++) {
+					s[j] = field_mul_add(F, v[j], s[j], x[i + j]);
+				}
+			}
+			for (int j = 0; j < len; j++) {
+				v[j] = field_mul_add(F, a[k], v[j], x[i + j]);
+			}
+		}
+		for (int j = 0; j < len; j++) {
+			values[i + j] = v[j];
+			if (slopes) {
+				slopes[i + j] = s[j];
+			}
+		}
+	}
+}
+
+/** Builds the tree of products of x - x_i over the n points x, halving them at
+ * each level, down to leaves of at most EVALUATE_LEAF_POINTS points */
+ProductTree *build_tree(coeff_t *x, int n, Field *F)
+{
+	ProductTree *T = malloc(sizeof(ProductTree));
+	T->n = n;
+	T->left = T->right = NULL;
+
+	if (n > EVALUATE_LEAF_POINTS) {
+		T->left = build_tree(x, n / 2, F);
+		T->right = build_tree(x + n / 2, n - n / 2, F);
+		T->poly = poly_mul(T->left->poly, T->right->poly, F);
+		return T;
+	}
+
+	/* multiply the linear factors in one at a time */
+	T->poly = init_polynomial(n);
+	coeff_t *c = T->poly->coefficients;
+	c[0] = 1;
+	for (int i = 0; i < n; i++) {
+		c[i + 1] = c[i];
+		for (int j = i; j > 0; j--) {
+			c[j] = field_sub(F, c[j - 1], field_mul(F, x[i], c[j]));
+		}
+		c[0] = field_neg(F, field_mul(F, x[i], c[0]));
+	}
+	return T;
+}
+
+/** Reduces f, and d if it is not NULL, mod the product at a node, and passes
+ * the remainders on to its children, or at a leaf evaluates them at its
+ * points. f(x_i) is f mod (x - x_i), which this remainder keeps. */
+void descend(ProductTree *T, Polynomial *f, Polynomial *d, coeff_t *x,
+		coeff_t *values, coeff_t *slopes, Field *F)
+{
+	Polynomial *rf = rem_p(f, T->poly, F);
+	Polynomial *rd = d ? rem_p(d, T->poly, F) : NULL;
+
+	if (!T->left) {
+		horner(values, NULL, rf->coefficients, rf->degree, x, T->n, F);
+		if (rd) {
+			horner(slopes, NULL, rd->coefficients, rd->degree, x, T->n, F);
+		}
+	} else {
+		int h = T->left->n;
+		descend(T->left, rf, rd, x, values, slopes, F);
+		descend(T->right, rf, rd, x + h, values + h, slopes ? slopes + h
+				: NULL, F);
+	}
+
+	free_polynomial(rf);
+	if (rd) {
+		free_polynomial(rd);
+	}
+}
+
+/** Frees a tree of products */
+void free_tree(ProductTree *T)
+{
+	if (T->left) {
+		free_tree(T->left);
+		free_tree(T->right);
+	}
+	free_polynomial(T->poly);
+	free(T);
+}
@@ -0,0 +1,57 @@
+/**
+ * @file    evaluate.h
+ * @brief   Evaluation of a polynomial and its derivative at many points at
+ *          once.
+ *
+ * Small batches use Horner's rule, run over a block of points side by side so
+ * that the multiplications for different points do not wait on each other.
+ * With AVX2 or SSE4.1 and an odd modulus of the default width, each step of a
+ * block is done in vector lanes, in Montgomery form as the matrix row
+ * operations are. Large batches use a remainder tree instead: the products of
+ * x - x_i over ever larger groups of points are built from the bottom up, and f
+ * and f' are reduced down the tree, so that near the leaves only remainders of
+ * low degree are left to evaluate. That costs O(M(n) log n) for n points,
+ * rather than O(nd) for f of degree d.
+ */
+
+#ifndef EVALUATE
+#define EVALUATE
+
+#include "euclid.h"
+
+/* Number of points, and degree of f, from which evaluate_many uses a remainder
+ * tree rather than Horner's rule, first when Horner's rule runs on scalars and
+ * then when it runs in vector lanes, which holds out far longer. Below a node
+ * of the tree with at most EVALUATE_LEAF_POINTS points, the remainder is
+ * evaluated by Horner's rule rather than split further. */
+#define EVALUATE_TREE_THRESHOLD 1024
+#if !defined(WIDE_COEFFICIENTS) && defined(__AVX2__)
+#define EVALUATE_VECTOR_TREE_THRESHOLD 32768
+#else
+#define EVALUATE_VECTOR_TREE_THRESHOLD 16384
+#endif
+#define EVALUATE_LEAF_POINTS 64
+
+/* Number of points run through Horner's rule side by side */
+#define EVALUATE_BLOCK 8
+
+/**
+ * Evaluates a polynomial, and optionally its derivative, at n points over Z_m.
+ *
+ * @param[out] values
+ *     where f(x_i) should be written, for each of the n points
+ * @param[out] slopes
+ *     where f'(x_i) should be written, or NULL if it is not needed
+ * @param[in]  f
+ *     the polynomial, with integer coefficients
+ * @param[in]  points
+ *     array of the n points, which are reduced into Z_m first
+ * @param[in]  n
+ *     the number of points
+ * @param[in]  F
+ *     the field Z_m, or a ring Z_(p^k) made by init_ring
+ */
+void evaluate_many(coeff_t *values, coeff_t *slopes, Polynomial *f,
+		coeff_t *points, int n, Field *F);
+
+#endif
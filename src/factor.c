@@ -1,6 +1,16 @@
 /**
  * @file    factor.c
- * @brief   Finds the factors of a polynomial mod m.
+ * @brief   Finds the roots of a polynomial mod m.
+ *
+ * m is split into prime powers p^e. The roots of the polynomial mod each p are
+ * found by distinct_roots, without factorising it, and lifted to roots mod p^e
+ * with Hensel's lemma. Every combination of a root mod each prime power is then
+ * a root mod m, found with the Chinese remainder theorem.
+ *
+ * The prime powers are independent of each other, so each is a task on a pool
+ * of worker threads, and finding the roots takes about as long as the slowest
+ * prime power rather than all of them.
+ *
  * @author  L. Foxcroft
  * @date    TODO
  */
@@ -8,145 +18,223 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include "euclid.h"
-#include "berlekamp.h"
+#include "cantor.h"
 #include "lift.h"
+#include "pool.h"
+#include "primes.h"
+
+/* Most roots found mod each prime power. Multiple roots can have very many
+ * lifts, eg x^2 has p^(e/2) roots mod p^e. The roots mod m are printed as they
+ * are combined, so there is no limit on how many of those there are. */
+#define FACTOR_MAX_ROOTS (1 << 20)
 
 /* --- type definitions ------------------------------------------------------*/
 
-typedef struct factor_s {
-	int p;
+typedef struct subproblem {
+	Polynomial *f;
+	coeff_t p;
 	int exp;
-	struct factor_s *next;
-} Factor;
+	coeff_t power;            /* p^exp */
+	coeff_t *roots;           /* the roots of f mod p^exp, in order */
+	int num_roots;            /* or -1 if there are more than FACTOR_MAX_ROOTS */
+} Subproblem;
 
 /* --- function prototypes ---------------------------------------------------*/
 
-Factor *init_factor(int p, int exp);
-Factor *factorize(int *n, int x);
-void free_factors(Factor *factors);
+void solve_prime_power(void *arg);
+coeff_t *roots_mod_p(int *n, Polynomial *f, Field *F);
+void print_combined_roots(Subproblem *S, int num_subproblems, coeff_t m);
+void print_roots(coeff_t *roots, int n);
+int compare_coeffs(const void *a, const void *b);
 
 /* --- main routine ----------------------------------------------------------*/
 
 int main()
 {
 	/* Read in polynomial and divisor */
-	//Polynomial *p = scan_polynomial();
-	int m;
-	printf("Factor polynomial mod ...\n");
-	scanf("%d", &m);
+	printf("Polynomial f(x)\n");
+	Polynomial *f = scan_polynomial();
+	coeff_t m;
+	printf("Find roots mod ...\n");
+	scanf(COEFF_FMT, &m);
+	if (m < 1 || (dcoeff_t) m >> COEFF_MAX_BITS) {
+		printf("The modulus should be positive and below 2^%d\n",
+				COEFF_MAX_BITS);
+		free_polynomial(f);
+		return EXIT_FAILURE;
+	}
 
-	/* Factorize divisor, and convert linked list into parallel array, 1
-	 * containing the factors (divisors) and the other the exponents */
+	/* Factorize divisor, with a subproblem for each prime power */
 	int num_factors;
-	Factor *factors = factorize(&num_factors, m);
-	Factor *helper = factors;
+	PrimePower *factors = factor_integer(&num_factors, m);
 
-	int *divisors = malloc(sizeof(int) * num_factors);
-	int *exponents = malloc(sizeof(int) * num_factors);
+	Subproblem *S = malloc(sizeof(Subproblem) * (num_factors > 0 ? num_factors
+				: 1));
 	for (int i = 0; i < num_factors; i++) {
-		divisors[i] = helper->p;
-		exponents[i] = helper->exp;
-		helper = helper->next;
+		S[i].f = f;
+		S[i].p = factors[i].p;
+		S[i].exp = factors[i].exp;
+		S[i].power = 1;
+		for (int j = 0; j < factors[i].exp; j++) {
+			S[i].power *= factors[i].p;
+		}
+		S[i].roots = NULL;
 	}
 
-	free_factors(factors);
+	free(factors);
 
-	/* TODO delete, for debugging */
-	printf("%d factors\n", num_factors);
+	/* Print polynomial and divisor to make output easier to follow */
+	printf("f(x) = ");
+	print_polynomial(f);
+	printf("\nm = ");
 	for (int i = 0; i < num_factors; i++) {
-		printf("%d^%d, ", divisors[i], exponents[i]);
+		printf(i > 0 ? " * " COEFF_FMT "^%d" : COEFF_FMT "^%d", S[i].p,
+				S[i].exp);
 	}
-	printf("\n");
+	printf(num_factors > 0 ? "\n" : "1\n");
 
-	/* TODO Call berlekamp with polynomial and each divisor to find roots */
+	/* Find the roots mod each prime power at once */
+	Pool *P = init_pool(0);
+	for (int i = 0; i < num_factors; i++) {
+		pool_submit(P, solve_prime_power, S + i);
+	}
+	free_pool(P);
 
-	/* TODO Use Hensel's lemma to lift roots */
+	for (int i = 0; i < num_factors; i++) {
+		if (S[i].num_roots < 0) {
+			printf("More than %d roots mod " COEFF_FMT "^%d\n",
+					FACTOR_MAX_ROOTS, S[i].p, S[i].exp);
+		} else {
+			printf("%d roots mod " COEFF_FMT "^%d:", S[i].num_roots,
+					S[i].p, S[i].exp);
+			print_roots(S[i].roots, S[i].num_roots);
+		}
+	}
 
-	/* TODO Use remainder theorem to solve systems of congruences with roots */
+	/* Use remainder theorem to solve systems of congruences with roots */
+	print_combined_roots(S, num_factors, m);
 
-	free(exponents);
-	free(divisors);
+	/* Free allocated memory */
+	for (int i = 0; i < num_factors; i++) {
+		free(S[i].roots);
+	}
+	free(S);
+	free_polynomial(f);
 
 	return EXIT_SUCCESS;
 }
 
 /* --- utility functions -----------------------------------------------------*/
 
-/** Allocates memory for and returns a factor which represents p^exp */
-Factor *init_factor(int p, int exp)
-{
-	Factor *factor = malloc(sizeof(Factor));
-	factor->p = p;
-	factor->exp = exp;
-	factor->next = NULL;
-	return factor;
-}
-
-/** Use trial division to create a linked list which contains x's prime
- * factorization. Also count number of distinct prime factors and store in
- * variable pointed to by n. */
-Factor *factorize(int *n, int x)
+/** Finds the roots of f mod the prime power of the subproblem passed as arg,
+ * on a worker */
+void solve_prime_power(void *arg)
 {
-	/* Initialize head and tail of linked list, and number of factors */
-	Factor *head = NULL, *tail = NULL;
-	*n = 0;
-	
-	/* Count how many times 2 divides x, and update linked list if necessary */
-	int p = 2, cnt = 0;
-	while (x % 2 == 0) {
-		cnt++;
-		x /= 2;
+	Subproblem *S = arg;
+	Field *F = init_field(S->p);
+
+	int n;
+	coeff_t *roots = roots_mod_p(&n, S->f, F);
+	if (n < 0) {
+		S->num_roots = -1;
+	} else {
+		S->roots = lift_roots(&S->num_roots, roots, n, S->f, F, S->exp,
+				FACTOR_MAX_ROOTS);
 	}
-	if (cnt > 0) {
-		head = init_factor(2, cnt);
-		tail = head;
-		(*n)++;
+	if (S->roots) {
+		qsort(S->roots, S->num_roots, sizeof(coeff_t), compare_coeffs);
 	}
 
-	/* Now iterate over odd numbers and add them to list if they divide x */
-	p = 3;
-	cnt = 0;
-	while (x > 1) {
-		if (x % p == 0) {
-			x /= p;
-			cnt++;
-		} else {
-			if (cnt != 0) {
-				if (tail) {
-					tail->next = init_factor(p, cnt);
-					tail = tail->next;
-				} else {
-					head = init_factor(p, cnt);
-					tail = head;
-				}
-				(*n)++;
-			}
-			p += 2;
-			cnt = 0;
+	free(roots);
+	free_field(F);
+}
+
+/** Returns the distinct roots of f mod p, writing how many there are to n. If f
+ * is 0 mod p every element is a root, and if there are more than
+ * FACTOR_MAX_ROOTS of those n is set to -1. */
+coeff_t *roots_mod_p(int *n, Polynomial *f, Field *F)
+{
+	Polynomial *g = copy_polynomial(f);
+	normalize_p(g, F);
+	coeff_t *roots;
+
+	if (g->degree == 0 && g->coefficients[0] == 0) {
+		if (F->p > FACTOR_MAX_ROOTS) {
+			free_polynomial(g);
+			*n = -1;
+			return NULL;
 		}
+		roots = malloc(sizeof(coeff_t) * F->p);
+		for (coeff_t r = 0; r < F->p; r++) {
+			roots[r] = r;
+		}
+		*n = (int) F->p;
+		free_polynomial(g);
+		return roots;
 	}
 
-	/* Add last factor */
-	if (cnt != 0) {
-		if (tail) {
-			tail->next = init_factor(p, cnt);
-			tail = tail->next;
-		} else {
-			head = init_factor(p, cnt);
-			tail = head;
+	roots = distinct_roots(n, g, F);
+	free_polynomial(g);
+
+	return roots;
+}
+
+/** Combines a root mod each prime power in every possible way into the roots
+ * mod their product m, and prints them as they are found, without keeping
+ * them. Each list of roots is in order, and the last prime power's turns
+ * fastest, so the roots mod m come out in runs. */
+void print_combined_roots(Subproblem *S, int num_subproblems, coeff_t m)
+{
+	/* count the combinations, which are fewer than m */
+	long long total = 1;
+	for (int i = 0; i < num_subproblems; i++) {
+		if (S[i].num_roots < 0) {
+			printf("More than %d roots mod " COEFF_FMT "\n",
+					FACTOR_MAX_ROOTS, m);
+			return;
 		}
-		(*n)++;
+		total *= S[i].num_roots;
 	}
+	printf("%lld roots mod " COEFF_FMT ":", total, m);
+
+	/* the moduli are the same for every combination, so Garner's constants
+	 * are found once. With no moduli there is the single root 0 mod 1. */
+	int size = num_subproblems > 0 ? num_subproblems : 1;
+	coeff_t *moduli = malloc(sizeof(coeff_t) * size);
+	coeff_t **residues = malloc(sizeof(coeff_t *) * size);
+	int *counts = malloc(sizeof(int) * size);
+	for (int i = 0; i < num_subproblems; i++) {
+		moduli[i] = S[i].power;
+		residues[i] = S[i].roots;
+		counts[i] = S[i].num_roots;
+	}
+	CRT *C = init_crt(moduli, num_subproblems);
+	CRTStream *stream = init_crt_stream(C, residues, counts);
+	coeff_t x;
+	while (crt_next(stream, &x)) {
+		printf(" " COEFF_FMT, x);
+	}
+	printf("\n");
 
-	return head;
+	free_crt_stream(stream);
+	free_crt(C);
+	free(counts);
+	free(residues);
+	free(moduli);
 }
 
-/** Frees memory allocated to linked list of factors */
-void free_factors(Factor *factors) {
-	Factor *helper = factors;
-	while (factors) {
-		helper = factors;
-		factors = factors->next;
-		free(helper);
+/** Prints roots on the rest of the line, separated by spaces */
+void print_roots(coeff_t *roots, int n)
+{
+	for (int i = 0; i < n; i++) {
+		printf(" " COEFF_FMT, roots[i]);
 	}
+	printf("\n");
+}
+
+/** Orders coefficients for qsort */
+int compare_coeffs(const void *a, const void *b)
+{
+	coeff_t x = *(const coeff_t *) a, y = *(const coeff_t *) b;
+	return (x > y) - (x < y);
 }
@@ -0,0 +1,155 @@
+/**
+ * @file    factorise.c
+ * @brief   Square free decomposition, and the choice between the factorisation
+ *          algorithms in berlekamp.c and cantor.c.
+ */
+
+#include <stdlib.h>
+#include "arena.h"
+#include "berlekamp.h"
+#include "cantor.h"
+#include "factorise.h"
+
+/* --- function prototypes ---------------------------------------------------*/
+
+static int use_berlekamp(Polynomial *poly, Field *F);
+static void decompose(Polynomial **parts, int *multiplicities, int *count,
+		Polynomial *f, int scale, Arena *A, Field *F);
+
+/* --- factorise interface ---------------------------------------------------*/
+
+Polynomial **factorise(int *num_factors, Polynomial *poly, Field *F)
+{
+	if (use_berlekamp(poly, F)) {
+		return berlekamp(num_factors, poly, F);
+	}
+	return cantor_zassenhaus(num_factors, poly, F);
+}
+
+Polynomial **square_free(int *num_parts, int **multiplicities, Polynomial *poly,
+		Field *F)
+{
+	Arena *A = init_arena(ARENA_BLOCK_SIZE);
+	Polynomial *f = arena_polynomial(A, poly->degree);
+	monic_p_into(f, poly, F);
+	int n = f->degree > 0 ? f->degree : 1;
+	Polynomial **parts = malloc(sizeof(Polynomial *) * n);
+	*multiplicities = malloc(sizeof(int) * n);
+
+	*num_parts = 0;
+	decompose(parts, *multiplicities, num_parts, f, 1, A, F);
+	free_arena(A);
+
+	return parts;
+}
+
+Polynomial **full_factorisation(int *num_factors, int **multiplicities,
+		Polynomial *poly, Field *F)
+{
+	int n = poly->degree > 0 ? poly->degree : 1;
+	Polynomial **facs = malloc(sizeof(Polynomial *) * n);
+	*multiplicities = malloc(sizeof(int) * n);
+
+	int num_parts, count, *exponents;
+	Polynomial **parts = square_free(&num_parts, &exponents, poly, F);
+	Polynomial **part_facs;
+
+	/* every part factorised with Berlekamp shares one arena, released after
+	 * each part */
+	Arena *A = init_arena(ARENA_BLOCK_SIZE);
+
+	*num_factors = 0;
+	for (int i = 0; i < num_parts; i++) {
+		if (use_berlekamp(parts[i], F)) {
+			part_facs = berlekamp_in(&count, parts[i], A, F);
+			reset_arena(A);
+		} else {
+			part_facs = cantor_zassenhaus(&count, parts[i], F);
+		}
+		for (int j = 0; j < count; j++) {
+			(*multiplicities)[*num_factors] = exponents[i];
+			facs[(*num_factors)++] = part_facs[j];
+		}
+		free(part_facs);
+	}
+
+	free_arena(A);
+	free_polynomials(parts, num_parts);
+	free(exponents);
+
+	return facs;
+}
+
+/* --- utility functions -----------------------------------------------------*/
+
+/** Returns true if poly should be factorised with Berlekamp's algorithm rather
+ * than Cantor-Zassenhaus */
+int use_berlekamp(Polynomial *poly, Field *F)
+{
+	return F->p == 2 || F->p <= (coeff_t) BERLEKAMP_MAX_PRIME_PER_DEGREE
+		* poly->degree;
+}
+
+/** Appends the square free parts of the monic, trimmed polynomial f to parts,
+ * with their multiplicities times scale. Every intermediate polynomial comes
+ * from A, and only the parts are allocated normally.
+ *
+ * With c = gcd(f, f') and w = f / c, w is the product of the a_i whose
+ * exponent is not a multiple of m. Each pass strips one power from c, and
+ * w / gcd(w, c) is the part with exponent exactly i. Whatever remains of c has
+ * only exponents divisible by m, so it is a polynomial in x^m. */
+void decompose(Polynomial **parts, int *multiplicities, int *count,
+		Polynomial *f, int scale, Arena *A, Field *F)
+{
+	int n = f->degree;
+	if (n < 1) {
+		return;
+	}
+
+	/* everything below has degree at most n, so these buffers are reused */
+	coeff_t *work = arena_alloc(A, sizeof(coeff_t) * (2 * n + 2));
+	Polynomial *derivative = arena_polynomial(A, n);
+	Polynomial *c = arena_polynomial(A, n);
+	Polynomial *w = arena_polynomial(A, n);
+	Polynomial *y = arena_polynomial(A, n);
+	Polynomial *a = arena_polynomial(A, n);
+	Polynomial *r = arena_polynomial(A, n);
+	Polynomial *helper = arena_polynomial(A, n);
+	Polynomial *swap;
+
+	get_formal_derivative_into(derivative, f, F);
+	gcd_p_into(c, f, derivative, work, F);
+	monic_p_into(c, c, F);
+	long_div_into(w, r, f, c, F);
+
+	for (int i = 1; w->degree > 0; i++) {
+		gcd_p_into(y, w, c, work, F);
+		monic_p_into(y, y, F);
+
+		long_div_into(a, r, w, y, F);
+		if (a->degree > 0) {
+			parts[*count] = copy_polynomial(a);
+			multiplicities[(*count)++] = i * scale;
+		}
+
+		/* c = c / y and w = y, swapping buffers rather than copying */
+		long_div_into(helper, r, c, y, F);
+		swap = c;
+		c = helper;
+		helper = swap;
+		swap = w;
+		w = y;
+		y = swap;
+	}
+
+	if (c->degree < 1) {
+		return;
+	}
+
+	/* c(x) = g(x^m) = g(x)^m, since every element of Z_m is its own m-th power */
+	Polynomial *root = arena_polynomial(A, c->degree / F->p);
+	for (int i = 0; i <= root->degree; i++) {
+		root->coefficients[i] = c->coefficients[i * F->p];
+	}
+	decompose(parts, multiplicities, count, root, scale * (int) F->p, A, F);
+}
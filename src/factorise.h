@@ -0,0 +1,76 @@
+/**
+ * @file    factorise.h
+ * @brief   Prototypes for factorising polynomials over finite fields with
+ *          whichever algorithm suits the input best.
+ */
+
+#ifndef FACTORISE
+#define FACTORISE
+
+#include "euclid.h"
+
+/* Berlekamp's algorithm costs a matrix reduction and then a gcd for every
+ * element of Z_m, while Cantor-Zassenhaus costs about log m multiplications mod
+ * the input for every degree it searches. Measured on random square free
+ * inputs, Berlekamp is faster once m is at most this many times the degree. */
+#define BERLEKAMP_MAX_PRIME_PER_DEGREE 3
+
+/**
+ * Factorises a square free polynomial with either Berlekamp's algorithm or the
+ * Cantor-Zassenhaus algorithm, picked from its degree and the size of the
+ * field. Z_2 always goes to Berlekamp, which has a bit packed engine for it.
+ * The contract is the same as for berlekamp, except that a poly which is not
+ * square free gives NULL and no factors if Cantor-Zassenhaus is picked.
+ *
+ * @param[out] num_factors
+ *     pointer to the number of factors found, written to in function
+ * @param[in]  poly
+ *     pointer to the square free polynomial over Z_m to be factorised
+ * @param[in]  F
+ *     the field Z_m, where m is prime
+ * @return     an array of pointers to polynomial factors of poly
+ */
+Polynomial **factorise(int *num_factors, Polynomial *poly, Field *F);
+
+/**
+ * Square free decomposition. Writes poly, made monic, as a product of powers
+ * a_1^e_1 * a_2^e_2 * ... of square free, pairwise coprime polynomials, using
+ * gcds with the formal derivative in the manner of Yun. Where the derivative
+ * vanishes what is left is a polynomial in x^m, whose m-th root is taken and
+ * decomposed in turn.
+ *
+ * @param[out] num_parts
+ *     pointer to where the number of square free parts should be written
+ * @param[out] multiplicities
+ *     pointer to where an array of the exponents e_i should be written
+ * @param[in]  poly
+ *     pointer to the polynomial over Z_m to be decomposed
+ * @param[in]  F
+ *     the field Z_m, where m is prime
+ * @return     an array of pointers to the monic square free parts a_i
+ */
+Polynomial **square_free(int *num_parts, int **multiplicities, Polynomial *poly,
+		Field *F);
+
+/**
+ * Factorises any polynomial over Z_m. It is first split into square free parts,
+ * and only those are handed to factorise, so repeated factors are found once
+ * and reported with their multiplicity rather than factorised again.
+ *
+ * @param[out] num_factors
+ *     pointer to where the number of distinct irreducible factors should be
+ *     written
+ * @param[out] multiplicities
+ *     pointer to where an array holding the multiplicity of each factor should
+ *     be written
+ * @param[in]  poly
+ *     pointer to the polynomial over Z_m to be factorised
+ * @param[in]  F
+ *     the field Z_m, where m is prime
+ * @return     an array of pointers to the distinct monic irreducible factors
+ *             of poly, empty if poly is constant
+ */
+Polynomial **full_factorisation(int *num_factors, int **multiplicities,
+		Polynomial *poly, Field *F);
+
+#endif
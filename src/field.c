@@ -0,0 +1,138 @@
+/**
+ * @file    field.c
+ * @brief   Set up of the reduction constants used for arithmetic in Z_p.
+ */
+
+#include <stdlib.h>
+#include "euclid.h"
+#include "field.h"
+
+/* --- function prototypes ---------------------------------------------------*/
+
+static int is_small_prime(coeff_t p);
+
+/* --- field interface -------------------------------------------------------*/
+
+Field *init_field(coeff_t p)
+{
+	Field *F = malloc(sizeof(Field));
+	F->p = p;
+	F->prime = p;
+
+	/* count bits in p, then mu = floor(2^(2k) / p) fits in k + 1 bits */
+	F->k = 0;
+	while (F->k < COEFF_MAX_BITS && ((dcoeff_t) 1 << F->k) <= (dcoeff_t) p) {
+		F->k++;
+	}
+	F->mu = ((dcoeff_t) 1 << (2 * F->k)) / (dcoeff_t) p;
+
+#ifndef WIDE_COEFFICIENTS
+	/* Newton's iteration doubles the correct low bits of p^-1 each step */
+	unsigned int x = (unsigned int) p;
+	for (int i = 0; i < 5; i++) {
+		x *= 2 - (unsigned int) p * x;
+	}
+	F->pinv = -x;
+	F->r = (coeff_t) ((1ULL << 32) % (unsigned long long) p);
+#endif
+
+	/* tabulate inverses with a^-1 = -(p / a) * (p mod a)^-1, valid for primes */
+	F->inverses = NULL;
+	if (is_small_prime(p)) {
+		F->inverses = malloc(sizeof(coeff_t) * p);
+		F->inverses[0] = 0;
+		F->inverses[1] = 1;
+		for (coeff_t a = 2; a < p; a++) {
+			F->inverses[a] = field_neg(F, field_mul(F, p / a,
+						F->inverses[p % a]));
+		}
+	}
+
+	return F;
+}
+
+Field *init_ring(coeff_t p, int k)
+{
+	coeff_t q = p;
+	for (int i = 1; i < k; i++) {
+		q *= p;
+	}
+
+	/* no inverses are tabulated, as p^k is only prime when k is 1 */
+	Field *F = init_field(q);
+	F->prime = p;
+	return F;
+}
+
+void free_field(Field *F)
+{
+	free(F->inverses);
+	free(F);
+}
+
+coeff_t field_inv(Field *F, coeff_t a)
+{
+	COUNT(inversions, 1);
+	if (F->inverses) {
+		return F->inverses[a];
+	}
+
+	/* extended Euclid, only tracking the coefficient of a */
+	coeff_t s0 = 1, s1 = 0;
+	coeff_t r0 = a, r1 = F->p;
+	coeff_t q, helper;
+	while (r1 != 0) {
+		q = r0 / r1;
+
+		helper = s0 - q*s1;
+		s0 = s1;
+		s1 = helper;
+
+		helper = r0 - q*r1;
+		r0 = r1;
+		r1 = helper;
+	}
+	return field_elem(F, s0);
+}
+
+void field_batch_inv(Field *F, coeff_t *inv, coeff_t *a, int n)
+{
+	if (n <= 0) {
+		return;
+	}
+
+	/* prefix[i] = a[0] * ... * a[i] */
+	coeff_t *prefix = malloc(sizeof(coeff_t) * n);
+	prefix[0] = a[0];
+	for (int i = 1; i < n; i++) {
+		prefix[i] = field_mul(F, prefix[i - 1], a[i]);
+	}
+
+	/* walk back down, peeling one factor off the inverted product each step */
+	coeff_t acc = field_inv(F, prefix[n - 1]);
+	coeff_t helper;
+	for (int i = n - 1; i > 0; i--) {
+		helper = a[i];
+		inv[i] = field_mul(F, acc, prefix[i - 1]);
+		acc = field_mul(F, acc, helper);
+	}
+	inv[0] = acc;
+
+	free(prefix);
+}
+
+/* --- utility functions -----------------------------------------------------*/
+
+/** Checks if p is a prime no bigger than FIELD_TABLE_MAX, by trial division */
+int is_small_prime(coeff_t p)
+{
+	if (p > FIELD_TABLE_MAX) {
+		return FALSE;
+	}
+	for (coeff_t d = 2; d * d <= p; d++) {
+		if (p % d == 0) {
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
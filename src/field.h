@@ -0,0 +1,213 @@
+/**
+ * @file    field.h
+ * @brief   A context for arithmetic in Z_p, created once per modulus, which
+ *          holds the constants needed to reduce without hardware division.
+ *
+ * Reduction uses Barrett's method with base 2: for p with k bits we store
+ * mu = floor(4^k / p), and any x < 4^k can then be reduced with two shifts, a
+ * multiplication and at most two subtractions. Products of two elements of Z_p
+ * and sums of an element with such a product are always below 4^k.
+ *
+ * Coefficients are ints by default, which is fastest for primes below 2^31. If
+ * WIDE_COEFFICIENTS is defined, they are 64 bits wide instead and products are
+ * reduced in 128 bits, so primes up to 2^62 can be used. Both builds share the
+ * same source through the coeff_t and dcoeff_t types.
+ *
+ * Inverses of prime moduli up to FIELD_TABLE_MAX are tabulated when the context
+ * is created, so they cost a single load. Larger primes fall back to Euclid's
+ * algorithm, and callers needing many inverses at once should use
+ * field_batch_inv, which pays for only one.
+ */
+
+#ifndef FIELD
+#define FIELD
+
+#if !defined(WIDE_COEFFICIENTS) && (defined(__AVX2__) || defined(__SSE4_1__))
+#include <immintrin.h>
+#endif
+#include "counters.h"
+
+#define FIELD_TABLE_MAX (1 << 16)
+
+#ifdef WIDE_COEFFICIENTS
+typedef long long coeff_t;                     /* an element of Z_p */
+__extension__ typedef unsigned __int128 dcoeff_t; /* holds a product */
+#define COEFF_FMT "%lld"
+#define COEFF_MAX_BITS 62
+#else
+typedef int coeff_t;
+typedef unsigned long long dcoeff_t;
+#define COEFF_FMT "%d"
+#define COEFF_MAX_BITS 31
+#endif
+
+typedef struct field {
+	coeff_t p;          /* the modulus, 2 <= p < 2^COEFF_MAX_BITS */
+	coeff_t prime;      /* the prime that p is a power of, taken to be p itself
+	                     * unless the context was made by init_ring */
+	int k;              /* the number of bits in p */
+	dcoeff_t mu;        /* floor(4^k / p) */
+	coeff_t *inverses;  /* inverses[a] = a^-1, or NULL if p is not tabulated */
+#ifndef WIDE_COEFFICIENTS
+	unsigned int pinv;  /* -p^-1 mod 2^32 for odd p, for Montgomery reduction */
+	coeff_t r;          /* 2^32 mod p */
+#endif
+} Field;
+
+/**
+ * Allocates memory for and returns a context for arithmetic mod p. Any modulus
+ * works for addition and multiplication, but inverses only exist for units, so
+ * p should be prime when the context is used to divide.
+ *
+ * @param[in] p
+ *     the modulus, at least 2
+ * @return    a pointer to the new context
+ */
+Field *init_field(coeff_t p);
+
+/**
+ * Allocates memory for and returns a context for arithmetic mod p^k, for p
+ * prime. Only the units of Z_(p^k), the elements not divisible by p, can be
+ * inverted, but polynomials can be multiplied by poly_mul as they can over Z_p,
+ * which needs to know that the modulus is not prime to avoid methods that
+ * divide by 2 or 3, or need a field.
+ *
+ * @param[in] p
+ *     the prime
+ * @param[in] k
+ *     the power it should be raised to, at least 1, with p^k < 2^COEFF_MAX_BITS
+ * @return    a pointer to the new context
+ */
+Field *init_ring(coeff_t p, int k);
+
+/**
+ * Frees the memory allocated for a field context.
+ *
+ * @param[in] F
+ *     the context to be freed
+ */
+void free_field(Field *F);
+
+/**
+ * Finds the multiplicative inverse of a in Z_p.
+ *
+ * @param[in] F
+ *     the field we are working in
+ * @param[in] a
+ *     a unit of Z_p, already reduced
+ * @return    a^-1 in Z_p
+ */
+coeff_t field_inv(Field *F, coeff_t a);
+
+/**
+ * Inverts n units of Z_p at once using Montgomery's trick, with a single call
+ * to field_inv and 3(n - 1) multiplications. inv and a may be the same array.
+ *
+ * @param[in]  F
+ *     the field we are working in
+ * @param[out] inv
+ *     array of n elements where the inverses should be written
+ * @param[in]  a
+ *     array of n units of Z_p, already reduced
+ * @param[in]  n
+ *     the number of elements to invert
+ */
+void field_batch_inv(Field *F, coeff_t *inv, coeff_t *a, int n);
+
+/** Reduces x mod p, for any 0 <= x < 4^k */
+static inline coeff_t field_reduce(Field *F, dcoeff_t x)
+{
+	COUNT(reductions, 1);
+	dcoeff_t q = ((x >> (F->k - 1)) * F->mu) >> (F->k + 1);
+	dcoeff_t r = x - q * (dcoeff_t) F->p;
+	while (r >= (dcoeff_t) F->p) {
+		r -= F->p;
+	}
+	return (coeff_t) r;
+}
+
+/** Maps any integer into Z_p. Only divides if a is not already reduced. */
+static inline coeff_t field_elem(Field *F, coeff_t a)
+{
+	if (a >= 0 && a < F->p) {
+		return a;
+	}
+	COUNT(reductions, 1);
+	coeff_t c = a % F->p;
+	return c < 0 ? c + F->p : c;
+}
+
+/** Returns a + b in Z_p. a + b itself may not fit in a coeff_t for p near
+ * 2^COEFF_MAX_BITS, so p - b is taken off a instead. */
+static inline coeff_t field_add(Field *F, coeff_t a, coeff_t b)
+{
+	coeff_t c = a - (F->p - b);
+	return c < 0 ? c + F->p : c;
+}
+
+/** Returns a - b in Z_p */
+static inline coeff_t field_sub(Field *F, coeff_t a, coeff_t b)
+{
+	coeff_t c = a - b;
+	return c < 0 ? c + F->p : c;
+}
+
+/** Returns -a in Z_p */
+static inline coeff_t field_neg(Field *F, coeff_t a)
+{
+	return a == 0 ? 0 : F->p - a;
+}
+
+/** Returns a * b in Z_p */
+static inline coeff_t field_mul(Field *F, coeff_t a, coeff_t b)
+{
+	return field_reduce(F, (dcoeff_t) a * (dcoeff_t) b);
+}
+
+/** Returns c + a * b in Z_p, with a single reduction */
+static inline coeff_t field_mul_add(Field *F, coeff_t c, coeff_t a, coeff_t b)
+{
+	return field_reduce(F, (dcoeff_t) a * (dcoeff_t) b + (dcoeff_t) c);
+}
+
+#if !defined(WIDE_COEFFICIENTS) && defined(__AVX2__)
+/** c + a * b * 2^-32 mod p in each of 8 lanes, for a, b and c in Z_p and odd p,
+ * with pinv and p broadcast from the context. The even and odd lanes are
+ * multiplied separately into 64-bit lanes and each reduced with
+ * t = x + ((x * pinv) mod 2^32) * p, whose top half is below 2p. Passing
+ * b * 2^32 mod p, from field_mul(F, b, F->r), gives c + a * b. */
+static inline __m256i mul_add_8(__m256i c, __m256i a, __m256i b, __m256i pinv,
+		__m256i p)
+{
+	__m256i xe = _mm256_mul_epu32(a, b);
+	__m256i xo = _mm256_mul_epu32(_mm256_srli_epi64(a, 32),
+			_mm256_srli_epi64(b, 32));
+	__m256i te = _mm256_add_epi64(xe,
+			_mm256_mul_epu32(_mm256_mul_epu32(xe, pinv), p));
+	__m256i to = _mm256_add_epi64(xo,
+			_mm256_mul_epu32(_mm256_mul_epu32(xo, pinv), p));
+
+	/* top halves of te and to hold the results, so gather them together */
+	__m256i u = _mm256_blend_epi32(_mm256_srli_epi64(te, 32), to, 0xAA);
+	u = _mm256_min_epu32(u, _mm256_sub_epi32(u, p));
+	u = _mm256_add_epi32(u, c);
+	return _mm256_min_epu32(u, _mm256_sub_epi32(u, p));
+}
+#elif !defined(WIDE_COEFFICIENTS) && defined(__SSE4_1__)
+/** As mul_add_8, for 4 lanes */
+static inline __m128i mul_add_4(__m128i c, __m128i a, __m128i b, __m128i pinv,
+		__m128i p)
+{
+	__m128i xe = _mm_mul_epu32(a, b);
+	__m128i xo = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+	__m128i te = _mm_add_epi64(xe, _mm_mul_epu32(_mm_mul_epu32(xe, pinv), p));
+	__m128i to = _mm_add_epi64(xo, _mm_mul_epu32(_mm_mul_epu32(xo, pinv), p));
+
+	__m128i u = _mm_blend_epi16(_mm_srli_epi64(te, 32), to, 0xCC);
+	u = _mm_min_epu32(u, _mm_sub_epi32(u, p));
+	u = _mm_add_epi32(u, c);
+	return _mm_min_epu32(u, _mm_sub_epi32(u, p));
+}
+#endif
+
+#endif
@@ -0,0 +1,489 @@
+/**
+ * @file    gf2.c
+ * @brief   Implementation of packed polynomial arithmetic and Berlekamp's
+ *          algorithm over Z_2.
+ *
+ * Over Z_2 the Frobenius map is squaring, so each row x^(2i) mod f of the
+ * Berlekamp matrix is the previous row shifted by two places and reduced by at
+ * most two XORs of f. The matrix is then eliminated with the Method of Four
+ * Russians: columns are handled in blocks of GF2_M4RI_BITS, and every other row
+ * is cleared of a whole block with one lookup into a table of combinations of
+ * that block's pivot rows.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#ifdef __PCLMUL__
+#include <wmmintrin.h>
+#endif
+#include "euclid.h"
+#include "gf2.h"
+#include "pool.h"
+
+/* --- macros ----------------------------------------------------------------*/
+
+#define BIT(a, i) (((a)[(i) / 64] >> ((i) % 64)) & 1)
+#define SET_BIT(a, i) ((a)[(i) / 64] ^= 1ULL << ((i) % 64))
+
+/* --- type definitions ------------------------------------------------------*/
+
+/* A polynomial to be split by a job of its own. Its irreducible factors are
+ * written from facs[slot] on, each of them at the slot after the degrees of the
+ * factors before it, so no two jobs write the same slot. */
+typedef struct split_job {
+	Polynomial **facs;
+	int slot;
+	Gf2Polynomial *f;        /* freed by the job */
+} SplitJob;
+
+/* --- function prototypes ---------------------------------------------------*/
+
+static Gf2Polynomial *copy_gf2_polynomial(Gf2Polynomial *p);
+static void clmul(uint64_t *lo, uint64_t *hi, uint64_t a, uint64_t b);
+static void xor_shifted(uint64_t *dst, int dst_words, uint64_t *src,
+		int src_words, int shift);
+static void xor_row(uint64_t *dst, uint64_t *src, int words);
+static int gauss_jordan_m4ri(uint64_t **A, int m, int n, int words,
+		int *pivots);
+static void split(Polynomial **facs, int *counter, Gf2Polynomial *f);
+static void split_job(Scheduler *S, int worker, void *arg);
+static SplitJob *init_split_job(Polynomial **facs, int slot, Gf2Polynomial *f);
+static Gf2Polynomial *splitting_element(Gf2Polynomial ***subalgebra,
+		int *nullity, Gf2Polynomial *f);
+
+/* --- gf2 interface ---------------------------------------------------------*/
+
+Gf2Polynomial *init_gf2_polynomial(int degree)
+{
+	Gf2Polynomial *p = malloc(sizeof(Gf2Polynomial));
+	p->degree = degree;
+	p->words = degree / 64 + 1;
+	p->bits = calloc(p->words, sizeof(uint64_t));
+	return p;
+}
+
+void free_gf2_polynomial(Gf2Polynomial *p)
+{
+	free(p->bits);
+	free(p);
+}
+
+Gf2Polynomial *to_gf2(Polynomial *p)
+{
+	Gf2Polynomial *packed = init_gf2_polynomial(p->degree);
+	for (int i = 0; i <= p->degree; i++) {
+		if (p->coefficients[i] % 2 != 0) {
+			SET_BIT(packed->bits, i);
+		}
+	}
+	return packed;
+}
+
+Polynomial *from_gf2(Gf2Polynomial *p)
+{
+	int n = gf2_degree(p);
+	Polynomial *unpacked = init_polynomial(n > 0 ? n : 0);
+	for (int i = 0; i <= n; i++) {
+		unpacked->coefficients[i] = BIT(p->bits, i);
+	}
+	return unpacked;
+}
+
+int gf2_degree(Gf2Polynomial *p)
+{
+	for (int w = p->words - 1; w >= 0; w--) {
+		if (p->bits[w]) {
+			return 64*w + 63 - __builtin_clzll(p->bits[w]);
+		}
+	}
+	return -1;
+}
+
+Gf2Polynomial *gf2_mul(Gf2Polynomial *p1, Gf2Polynomial *p2)
+{
+	Gf2Polynomial *r = init_gf2_polynomial(p1->degree + p2->degree);
+	uint64_t lo, hi;
+
+	/* schoolbook over words, each word product being 128 bits */
+	for (int i = 0; i < p1->words; i++) {
+		if (p1->bits[i] == 0) {
+			continue;
+		}
+		for (int j = 0; j < p2->words; j++) {
+			clmul(&lo, &hi, p1->bits[i], p2->bits[j]);
+			r->bits[i + j] ^= lo;
+			if (i + j + 1 < r->words) {
+				r->bits[i + j + 1] ^= hi;
+			}
+		}
+	}
+
+	return r;
+}
+
+void gf2_rem(Gf2Polynomial *r, Gf2Polynomial *f)
+{
+	int df = gf2_degree(f);
+	for (int i = gf2_degree(r); i >= df; i--) {
+		if (BIT(r->bits, i)) {
+			xor_shifted(r->bits, r->words, f->bits, f->words, i - df);
+		}
+	}
+}
+
+Gf2Polynomial *gf2_gcd(Gf2Polynomial *p1, Gf2Polynomial *p2)
+{
+	Gf2Polynomial *r0 = copy_gf2_polynomial(p1);
+	Gf2Polynomial *r1 = copy_gf2_polynomial(p2);
+	Gf2Polynomial *helper;
+
+	while (gf2_degree(r1) >= 0) {
+		gf2_rem(r0, r1);
+		helper = r0;
+		r0 = r1;
+		r1 = helper;
+	}
+
+	free_gf2_polynomial(r1);
+
+	return r0;
+}
+
+Gf2Polynomial **gf2_subalgebra(int *nullity, Gf2Polynomial *f)
+{
+	/* constants have no subalgebra to speak of */
+	int n = gf2_degree(f);
+	if (n < 1) {
+		*nullity = 0;
+		return NULL;
+	}
+	COUNT(matrices, 1);
+
+	/* rows of (B - I)^T, in a single allocation */
+	int words = (n + 63) / 64;
+	uint64_t *block = calloc((size_t) n * words, sizeof(uint64_t));
+	uint64_t **A = malloc(sizeof(uint64_t *) * n);
+	for (int i = 0; i < n; i++) {
+		A[i] = block + (size_t) i * words;
+	}
+
+	/* row i of B is x^(2i) mod f, which is column i of (B - I)^T */
+	Gf2Polynomial *row = init_gf2_polynomial(n + 1);
+	row->bits[0] = 1;
+	uint64_t helper;
+	for (int i = 0; i < n; i++) {
+		for (int w = 0; w < words; w++) {
+			helper = row->bits[w];
+			while (helper) {
+				SET_BIT(A[64*w + __builtin_ctzll(helper)], i);
+				helper &= helper - 1;
+			}
+		}
+		SET_BIT(A[i], i);
+
+		/* multiply by x^2, then clear the two bits that might reach n */
+		for (int w = row->words - 1; w > 0; w--) {
+			row->bits[w] = (row->bits[w] << 2) | (row->bits[w - 1] >> 62);
+		}
+		row->bits[0] <<= 2;
+		for (int b = n + 1; b >= n; b--) {
+			if (BIT(row->bits, b)) {
+				xor_shifted(row->bits, row->words, f->bits, f->words, b - n);
+			}
+		}
+	}
+	free_gf2_polynomial(row);
+
+	/* reduce, then read a basis vector off every free column */
+	int *pivots = malloc(sizeof(int) * n);
+	int rank = gauss_jordan_m4ri(A, n, n, words, pivots);
+	*nullity = n - rank;
+	Gf2Polynomial **kernel = malloc(sizeof(Gf2Polynomial *) * *nullity);
+
+	int free_variables = 0, next_pivot = 0;
+	for (int col = 0; col < n; col++) {
+		if (next_pivot < rank && pivots[next_pivot] == col) {
+			next_pivot++;
+			continue;
+		}
+		kernel[free_variables] = init_gf2_polynomial(n - 1);
+		SET_BIT(kernel[free_variables]->bits, col);
+		for (int r = 0; r < rank; r++) {
+			if (BIT(A[r], col)) {
+				SET_BIT(kernel[free_variables]->bits, pivots[r]);
+			}
+		}
+		free_variables++;
+	}
+
+	free(pivots);
+	free(A);
+	free(block);
+
+	return kernel;
+}
+
+Polynomial **gf2_berlekamp(int *num_factors, Polynomial *poly)
+{
+	Gf2Polynomial *f = to_gf2(poly);
+
+	/* there are at most deg(f) factors */
+	int n = gf2_degree(f);
+	Polynomial **facs = malloc(sizeof(Polynomial *) * (n > 1 ? n : 1));
+	*num_factors = 0;
+
+	Pool *P = n >= GF2_PARALLEL_DEGREE ? shared_pool() : NULL;
+	if (n < 1) {
+		/* constants are their own factorisation */
+		facs[(*num_factors)++] = from_gf2(f);
+	} else if (!P) {
+		split(facs, num_factors, f);
+	} else {
+		/* split the pieces as jobs, each writing its factors to slots of its
+		 * own, and then close up the gaps left by factors of degree above 1 */
+		for (int i = 0; i < n; i++) {
+			facs[i] = NULL;
+		}
+		pool_fork(P, split_job, init_split_job(facs, 0,
+					copy_gf2_polynomial(f)));
+		for (int i = 0; i < n; i++) {
+			if (facs[i]) {
+				facs[(*num_factors)++] = facs[i];
+			}
+		}
+	}
+
+	free_gf2_polynomial(f);
+
+	return facs;
+}
+
+/* --- utility functions -----------------------------------------------------*/
+
+/** Allocates memory for and returns a copy of a packed polynomial */
+Gf2Polynomial *copy_gf2_polynomial(Gf2Polynomial *p)
+{
+	Gf2Polynomial *new_poly = init_gf2_polynomial(p->degree);
+	memcpy(new_poly->bits, p->bits, sizeof(uint64_t) * p->words);
+	return new_poly;
+}
+
+/** Carry-less product of two words, written as its low and high words */
+void clmul(uint64_t *lo, uint64_t *hi, uint64_t a, uint64_t b)
+{
+#ifdef __PCLMUL__
+	__m128i r = _mm_clmulepi64_si128(_mm_cvtsi64_si128((long long) a),
+			_mm_cvtsi64_si128((long long) b), 0);
+	*lo = (uint64_t) _mm_cvtsi128_si64(r);
+	*hi = (uint64_t) _mm_cvtsi128_si64(_mm_unpackhi_epi64(r, r));
+#else
+	/* table of b times every polynomial of degree below 4 */
+	uint64_t tlo[16], thi[16];
+	tlo[0] = thi[0] = 0;
+	for (int i = 1; i < 16; i++) {
+		int k = __builtin_ctz(i);
+		tlo[i] = tlo[i & (i - 1)] ^ (b << k);
+		thi[i] = thi[i & (i - 1)] ^ (k ? b >> (64 - k) : 0);
+	}
+
+	/* then consume a four bits at a time, from the top */
+	uint64_t l = 0, h = 0;
+	int t;
+	for (int s = 60; s >= 0; s -= 4) {
+		h = (h << 4) | (l >> 60);
+		l <<= 4;
+		t = (a >> s) & 15;
+		l ^= tlo[t];
+		h ^= thi[t];
+	}
+	*lo = l;
+	*hi = h;
+#endif
+}
+
+/** XORs src, shifted up by shift bits, into dst. Bits past dst are dropped. */
+void xor_shifted(uint64_t *dst, int dst_words, uint64_t *src, int src_words,
+		int shift)
+{
+	int ws = shift / 64, bs = shift % 64;
+	for (int i = 0; i < src_words && i + ws < dst_words; i++) {
+		dst[i + ws] ^= src[i] << bs;
+		if (bs && i + ws + 1 < dst_words) {
+			dst[i + ws + 1] ^= src[i] >> (64 - bs);
+		}
+	}
+}
+
+/** dst = dst + src, for rows of the given number of words */
+void xor_row(uint64_t *dst, uint64_t *src, int words)
+{
+	COUNT(row_ops, 1);
+	for (int w = 0; w < words; w++) {
+		dst[w] ^= src[w];
+	}
+}
+
+/** Reduces an m x n bit matrix to reduced row echelon form in place, with the
+ * Method of Four Russians. Writes the pivot column of each of the first rank
+ * rows to pivots, and returns the rank. */
+int gauss_jordan_m4ri(uint64_t **A, int m, int n, int words, int *pivots)
+{
+	int rank = 0, start, i, j, c, t, mask;
+	uint64_t *helper;
+	uint64_t *table = malloc(sizeof(uint64_t) * words << GF2_M4RI_BITS);
+
+	for (int c0 = 0; c0 < n && rank < m; c0 += GF2_M4RI_BITS) {
+		/* Find up to GF2_M4RI_BITS pivots in this block the usual way, only
+		 * reducing candidate rows by pivots from the same block */
+		start = rank;
+		for (c = c0; c < c0 + GF2_M4RI_BITS && c < n && rank < m; c++) {
+			for (i = rank; i < m; i++) {
+				for (j = start; j < rank; j++) {
+					if (BIT(A[i], pivots[j])) {
+						xor_row(A[i], A[j], words);
+					}
+				}
+				if (BIT(A[i], c)) {
+					break;
+				}
+			}
+			if (i == m) {
+				continue;
+			}
+
+			helper = A[i];
+			A[i] = A[rank];
+			A[rank] = helper;
+			for (j = start; j < rank; j++) {
+				if (BIT(A[j], c)) {
+					xor_row(A[j], A[rank], words);
+				}
+			}
+			pivots[rank++] = c;
+		}
+
+		t = rank - start;
+		if (t == 0) {
+			continue;
+		}
+
+		/* table[mask] is the sum of pivot rows start + b for bits b in mask */
+		memset(table, 0, sizeof(uint64_t) * words);
+		for (mask = 1; mask < 1 << t; mask++) {
+			memcpy(table + (size_t) mask * words,
+					table + (size_t) (mask & (mask - 1)) * words,
+					sizeof(uint64_t) * words);
+			xor_row(table + (size_t) mask * words,
+					A[start + __builtin_ctz(mask)], words);
+		}
+
+		/* clear the whole block from every other row with one lookup */
+		for (i = 0; i < m; i++) {
+			if (i >= start && i < rank) {
+				continue;
+			}
+			mask = 0;
+			for (j = 0; j < t; j++) {
+				mask |= (int) BIT(A[i], pivots[start + j]) << j;
+			}
+			if (mask) {
+				xor_row(A[i], table + (size_t) mask * words, words);
+			}
+		}
+	}
+
+	free(table);
+
+	return rank;
+}
+
+/** Splits f with its Berlekamp subalgebra and recurses on both parts, until
+ * only irreducible factors are left, which are appended to facs */
+void split(Polynomial **facs, int *counter, Gf2Polynomial *f)
+{
+	int nullity;
+	Gf2Polynomial **subalgebra;
+	Gf2Polynomial *g = splitting_element(&subalgebra, &nullity, f);
+
+	if (!g) {
+		facs[(*counter)++] = from_gf2(f);
+	} else {
+		/* f = gcd(f, g) * gcd(f, g + 1), and both are non trivial */
+		Gf2Polynomial *a = gf2_gcd(f, g);
+		g->bits[0] ^= 1;
+		Gf2Polynomial *b = gf2_gcd(f, g);
+		split(facs, counter, a);
+		split(facs, counter, b);
+		free_gf2_polynomial(a);
+		free_gf2_polynomial(b);
+	}
+
+	for (int i = 0; i < nullity; i++) {
+		free_gf2_polynomial(subalgebra[i]);
+	}
+	free(subalgebra);
+}
+
+/** Splits the polynomial of the SplitJob passed as arg like split, but spawns
+ * the second part of each split as a job of its own and carries on with the
+ * first, until the parts are too small to be worth sharing */
+void split_job(Scheduler *S, int worker, void *arg)
+{
+	SplitJob *J = arg;
+	Gf2Polynomial *f = J->f;
+	int nullity, counter;
+	Gf2Polynomial **subalgebra, *g, *a, *b;
+
+	while (gf2_degree(f) >= GF2_PARALLEL_DEGREE) {
+		g = splitting_element(&subalgebra, &nullity, f);
+		if (!g) {
+			break;
+		}
+
+		a = gf2_gcd(f, g);
+		g->bits[0] ^= 1;
+		b = gf2_gcd(f, g);
+		for (int i = 0; i < nullity; i++) {
+			free_gf2_polynomial(subalgebra[i]);
+		}
+		free(subalgebra);
+		free_gf2_polynomial(f);
+
+		/* the factors of a come first, and take up at most its degree */
+		pool_spawn(S, worker, split_job, init_split_job(J->facs,
+					J->slot + gf2_degree(a), b));
+		f = a;
+	}
+
+	counter = 0;
+	split(J->facs + J->slot, &counter, f);
+	free_gf2_polynomial(f);
+	free(J);
+}
+
+/** Allocates memory for and returns a job splitting f, which it takes
+ * ownership of */
+SplitJob *init_split_job(Polynomial **facs, int slot, Gf2Polynomial *f)
+{
+	SplitJob *J = malloc(sizeof(SplitJob));
+	J->facs = facs;
+	J->slot = slot;
+	J->f = f;
+	return J;
+}
+
+/** Finds the Berlekamp subalgebra of f, which the caller should free, and
+ * returns a non constant element of it, or NULL if f is irreducible */
+Gf2Polynomial *splitting_element(Gf2Polynomial ***subalgebra, int *nullity,
+		Gf2Polynomial *f)
+{
+	*subalgebra = gf2_subalgebra(nullity, f);
+	for (int i = 0; i < *nullity; i++) {
+		if (gf2_degree((*subalgebra)[i]) > 0) {
+			return (*subalgebra)[i];
+		}
+	}
+	return NULL;
+}
@@ -0,0 +1,134 @@
+/**
+ * @file    gf2.h
+ * @brief   Prototypes for a specialisation of polynomial arithmetic and
+ *          Berlekamp's algorithm to the field Z_2, using packed coefficients.
+ *
+ * Polynomials and matrix rows store 64 coefficients per word, so addition is
+ * XOR and row reduction works a word at a time.
+ */
+
+#ifndef GF2
+#define GF2
+
+#include <stdint.h>
+#include "euclid.h"
+
+/* Width of the column blocks used by the Method of Four Russians */
+#define GF2_M4RI_BITS 8
+
+/* Degree from which the pieces gf2_berlekamp splits a polynomial into are
+ * split further as separate jobs on the shared pool, if one has been set */
+#define GF2_PARALLEL_DEGREE 128
+
+typedef struct gf2_polynomial {
+	int degree;     /* as for Polynomial, this is the capacity */
+	int words;      /* number of words needed for degree + 1 coefficients */
+	uint64_t *bits; /* coefficient i is bit i % 64 of bits[i / 64] */
+} Gf2Polynomial;
+
+/**
+ * Allocates memory for and returns a packed polynomial over Z_2, with all of
+ * its coefficients set to zero.
+ *
+ * @param[in] degree
+ *     the degree of the polynomial to be initialized
+ * @return    a pointer to the new polynomial
+ */
+Gf2Polynomial *init_gf2_polynomial(int degree);
+
+/**
+ * Frees the memory allocated for a packed polynomial.
+ *
+ * @param[in] p
+ *     the polynomial to be freed
+ */
+void free_gf2_polynomial(Gf2Polynomial *p);
+
+/**
+ * Packs a polynomial, reducing its coefficients mod 2.
+ *
+ * @param[in] p
+ *     the polynomial to be packed
+ * @return    a pointer to a new packed polynomial equal to p mod 2
+ */
+Gf2Polynomial *to_gf2(Polynomial *p);
+
+/**
+ * Unpacks a polynomial over Z_2 into one coefficient per element.
+ *
+ * @param[in] p
+ *     the packed polynomial
+ * @return    a pointer to a new polynomial with the same coefficients, whose
+ *            degree is the actual degree of p
+ */
+Polynomial *from_gf2(Gf2Polynomial *p);
+
+/**
+ * Finds the actual degree of a packed polynomial.
+ *
+ * @param[in] p
+ *     the packed polynomial
+ * @return    the degree of p, or -1 if p is zero
+ */
+int gf2_degree(Gf2Polynomial *p);
+
+/**
+ * Multiplies two packed polynomials using carry-less multiplication of whole
+ * words, done in hardware if PCLMUL is available and with a table otherwise.
+ *
+ * @param[in] p1
+ *     pointer to the first factor
+ * @param[in] p2
+ *     pointer to the second factor
+ * @return    the product p1 * p2
+ */
+Gf2Polynomial *gf2_mul(Gf2Polynomial *p1, Gf2Polynomial *p2);
+
+/**
+ * Replaces r with its remainder after division by f. Each step of the division
+ * is a single shifted XOR of f into r.
+ *
+ * @param[in] r
+ *     the dividend, overwritten with the remainder
+ * @param[in] f
+ *     the non-zero divisor
+ */
+void gf2_rem(Gf2Polynomial *r, Gf2Polynomial *f);
+
+/**
+ * Euclid's algorithm for the gcd of two packed polynomials. Over Z_2 the
+ * result is always monic.
+ *
+ * @param[in] p1
+ *     pointer to the first polynomial
+ * @param[in] p2
+ *     pointer to the second polynomial
+ * @return    the gcd of p1 and p2
+ */
+Gf2Polynomial *gf2_gcd(Gf2Polynomial *p1, Gf2Polynomial *p2);
+
+/**
+ * Finds a basis for the Berlekamp subalgebra of f over Z_2. The matrix B - I is
+ * built already transposed, one bit per entry, and its null space is found by
+ * Gauss-Jordan elimination with the Method of Four Russians.
+ *
+ * @param[out] nullity
+ *     pointer to where the number of basis polynomials should be written
+ * @param[in]  f
+ *     the polynomial whose subalgebra we want, with degree at least 1
+ * @return     an array of nullity packed polynomials spanning the subalgebra
+ */
+Gf2Polynomial **gf2_subalgebra(int *nullity, Gf2Polynomial *f);
+
+/**
+ * Berlekamp's algorithm over Z_2, with the same contract as berlekamp.
+ *
+ * @param[out] num_factors
+ *     pointer to the number of factors found, written to in function
+ * @param[in]  poly
+ *     pointer to the polynomial over Z_2 to be factorised
+ * @return     an array of pointers to polynomial factors of poly
+ */
+Polynomial **gf2_berlekamp(int *num_factors, Polynomial *poly);
+
+#endif
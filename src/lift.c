@@ -2,9 +2,9 @@
  * @file    lift.c
  * @brief   Implementation of Hensel's lemma and the Chinese Remainder Theorem.
  *
- * Hensel's lemma is used to lift roots of polynomials mod p to higher powers of
- * p, and the remainder theorem is used to solve systems of congruences under
- * the condition that the divisors are pairwise coprime.
+ * Hensel's lemma is used to lift roots and factorisations of polynomials mod p
+ * to higher powers of p, and the remainder theorem is used to solve systems of
+ * congruences under the condition that the divisors are pairwise coprime.
  *
  * @author  L. Foxcroft
  * @date    2022-04-01
@@ -13,101 +13,537 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include "euclid.h"
+#include "evaluate.h"
 #include "lift.h"
 
+/* --- type definitions ------------------------------------------------------*/
+
+typedef struct factor_tree {
+	Polynomial *poly;            /* the product of the leaves below, monic */
+	Polynomial *s, *t;           /* s * left + t * right = 1, unless a leaf */
+	struct factor_tree *left;    /* the children, both NULL for a leaf */
+	struct factor_tree *right;
+} FactorTree;
+
 /* --- function prototypes ---------------------------------------------------*/
 
-int evaluate(Polynomial *f, int x, int m);
-int inverse(int a, int m);
+FactorTree *build_tree(Polynomial **factors, int n, Field *F);
+void lift_tree(FactorTree *T, Field *R, int last);
+void hensel_step(FactorTree *T, Field *R, int last);
+int take_leaves(Polynomial **leaves, FactorTree *T);
+void free_tree(FactorTree *T);
+Polynomial *add_p(Polynomial *a, Polynomial *b, int sign, int max_degree,
+		Field *R);
+void scale_p(Polynomial *a, coeff_t c, Field *F);
+coeff_t garner_step(CRT *C, int i, coeff_t x, coeff_t r);
 
 /* --- lift interface --------------------------------------------------------*/
 
-int is_simple_root(Polynomial *f, int root, int m)
+int is_simple_root(Polynomial *f, coeff_t root, Field *F)
 {
-	/* Evaluate f'(root) mod m */
-	Polynomial *f_prime = get_formal_derivative(f, m);
-	int val = evaluate(f_prime, root, m);
-	free_polynomial(f_prime);
-	return val != 0;
+	/* Evaluate f'(root) mod m, alongside f(root) */
+	coeff_t val, slope;
+	evaluate_many(&val, &slope, f, &root, 1, F);
+	return slope != 0;
 }
 
-int hensel(int *power, Polynomial *f, int root, int p, int k)
+coeff_t hensel(coeff_t *power, Polynomial *f, coeff_t root, Field *F, int k)
 {
-	int new_root = root;
-	int m = p;
-	int f_x;
-
-	/* Calculate [f'(x)]^-1 */
-	Polynomial *f_prime = get_formal_derivative(f, m);
-	int f_prime_x = evaluate(f_prime, root, m);
-	int f_prime_x_inv = inverse(f_prime_x, m);
-	
-	for (int i = 1; i <= k; i++) {
-		/* Calculate f(new_root) */
-		f_x = evaluate(f, new_root, m);
+	hensel_roots(power, &root, 1, f, F, k);
+	return root;
+}
 
-		/* Calculate new root */
-		new_root = new_root - f_x * f_prime_x_inv;
-		new_root = mod(new_root, m);
+void hensel_roots(coeff_t *power, coeff_t *roots, int n, Polynomial *f,
+		Field *F, int k)
+{
+	/* Calculate [f'(root)]^-1 mod p for every root, with one inversion */
+	int size = n > 0 ? n : 1;
+	coeff_t *values = malloc(sizeof(coeff_t) * size);
+	coeff_t *inverses = malloc(sizeof(coeff_t) * size);
+	coeff_t *slopes = malloc(sizeof(coeff_t) * size);
+	for (int i = 0; i < n; i++) {
+		roots[i] = field_elem(F, roots[i]);
+	}
+	evaluate_many(values, inverses, f, roots, n, F);
+	field_batch_inv(F, inverses, inverses, n);
 
-		/* Update divisor */
-		if (i != k) {
-			m *= p;
+	/* Work in Z_(p^e), doubling e each step until it reaches k. Given a root r
+	 * mod the old p^e and s = f'(r)^-1 mod the old p^e, s(2 - f'(r)s) is
+	 * f'(r)^-1 mod the new one, and then r - f(r)s is a root mod the new one
+	 * too. f and f' are evaluated at every root together. */
+	coeff_t m = F->p;
+	Field *R;
+	for (int e = 1; e < k; ) {
+		e = 2 * e < k ? 2 * e : k;
+		R = init_ring(F->p, e);
+		m = R->p;
+		evaluate_many(values, slopes, f, roots, n, R);
+		for (int i = 0; i < n; i++) {
+			inverses[i] = field_mul(R, inverses[i], field_sub(R,
+						field_elem(R, 2), field_mul(R, slopes[i],
+						inverses[i])));
+			roots[i] = field_sub(R, roots[i], field_mul(R, values[i],
+						inverses[i]));
 		}
+		free_field(R);
 	}
 
 	/* Store p^k */
 	*power = m;
 
-	free_polynomial(f_prime);
+	free(slopes);
+	free(inverses);
+	free(values);
+}
+
+coeff_t *lift_roots(int *num_roots, coeff_t *roots, int n, Polynomial *f,
+		Field *F, int k, int max_roots)
+{
+	/* Split the roots by whether they are simple */
+	coeff_t *simple = malloc(sizeof(coeff_t) * (n > 0 ? n : 1));
+	coeff_t *multiple = malloc(sizeof(coeff_t) * (n > 0 ? n : 1));
+	coeff_t *values = malloc(sizeof(coeff_t) * (n > 0 ? n : 1));
+	coeff_t *slopes = malloc(sizeof(coeff_t) * (n > 0 ? n : 1));
+	int num_simple = 0, num_multiple = 0;
+	evaluate_many(values, slopes, f, roots, n, F);
+	for (int i = 0; i < n; i++) {
+		if (slopes[i] != 0) {
+			simple[num_simple++] = roots[i];
+		} else {
+			multiple[num_multiple++] = roots[i];
+		}
+	}
+	free(slopes);
+	if (num_simple > max_roots) {
+		free(values);
+		free(multiple);
+		free(simple);
+		*num_roots = -1;
+		return NULL;
+	}
+
+	/* Every root mod p^k is written here, the simple ones first. It starts
+	 * with room for the roots mod p and grows as multiple roots multiply. */
+	int size = n > 0 ? n : 1;
+	coeff_t *lifted = malloc(sizeof(coeff_t) * size);
+	for (int i = 0; i < num_simple; i++) {
+		lifted[i] = simple[i];
+	}
+	free(simple);
+	coeff_t power;
+	hensel_roots(&power, lifted, num_simple, f, F, k);
+
+	/* Follow the multiple roots up one power of p at a time, writing the
+	 * roots mod p^(j + 1) after the simple ones. f(r + tp^j) = f(r) mod
+	 * p^(j + 1) for every t, as p divides f'(r) and 2j >= j + 1. */
+	coeff_t q = F->p;
+	int count;
+	Field *R;
+	for (int j = 1; j < k && num_multiple > 0; j++) {
+		R = init_ring(F->p, j + 1);
+		evaluate_many(values, NULL, f, multiple, num_multiple, R);
+		count = num_simple;
+		for (int i = 0; i < num_multiple && count >= 0; i++) {
+			if (values[i] != 0) {
+				continue;
+			}
+			if ((coeff_t) (max_roots - count) < F->p) {
+				count = -1;
+				break;
+			}
+			if ((coeff_t) (size - count) < F->p) {
+				while ((coeff_t) (size - count) < F->p) {
+					size = size <= max_roots / 2 ? 2 * size : max_roots;
+				}
+				lifted = realloc(lifted, sizeof(coeff_t) * size);
+			}
+			for (coeff_t t = 0; t < F->p; t++) {
+				lifted[count++] = multiple[i] + t * q;
+			}
+		}
+		free_field(R);
+		if (count < 0) {
+			free(values);
+			free(multiple);
+			free(lifted);
+			*num_roots = -1;
+			return NULL;
+		}
+
+		free(values);
+		free(multiple);
+		num_multiple = count - num_simple;
+		values = malloc(sizeof(coeff_t) * (num_multiple > 0 ? num_multiple
+					: 1));
+		multiple = malloc(sizeof(coeff_t) * (num_multiple > 0 ? num_multiple
+					: 1));
+		for (int i = 0; i < num_multiple; i++) {
+			multiple[i] = lifted[num_simple + i];
+		}
+		q *= F->p;
+	}
 
-	return new_root;
+	/* The multiple roots left are roots mod p^k */
+	free(values);
+	if (num_simple + num_multiple > max_roots) {
+		free(multiple);
+		free(lifted);
+		*num_roots = -1;
+		return NULL;
+	}
+	for (int i = 0; i < num_multiple; i++) {
+		lifted[num_simple + i] = multiple[i];
+	}
+	*num_roots = num_simple + num_multiple;
+	free(multiple);
+
+	return lifted;
 }
 
-int chinese_remainder(int *product, int num_congruences, int *remainders,
-		int *divisors)
+Polynomial **hensel_factors(coeff_t *power, Polynomial *f,
+		Polynomial **factors, int num_factors, Field *F, int k)
 {
-	/* Bezout coefficients, current 2 solutions and moduli */
-	int s, t, a1, a2, n1, n2;
-	a1 = remainders[0];
-	a2 = remainders[1];
-	n1 = divisors[0];
-	n2 = divisors[1];
+	/* f / lc(f) mod p^k, where lc(f) is a unit as p does not divide it */
+	Field *R = init_ring(F->p, k);
+	int d = f->degree;
+	while (d > 0 && field_elem(F, f->coefficients[d]) == 0) {
+		d--;
+	}
+	coeff_t lc_inv = field_inv(R, field_elem(R, f->coefficients[d]));
+	Polynomial *monic = init_polynomial(d);
+	for (int i = 0; i <= d; i++) {
+		monic->coefficients[i] = field_mul(R, field_elem(R,
+					f->coefficients[i]), lc_inv);
+	}
+
+	/* The tree is built mod p, then its root replaced by f itself */
+	FactorTree *T = build_tree(factors, num_factors, F);
+	free_polynomial(T->poly);
+	T->poly = monic;
 
-	/* Iterate over equations and build up solution */
-	for (int i = 1; i < num_congruences; i++) {
-		a2 = remainders[i];
-		n2 = divisors[i];
-		extended_gcd_z(&s, &t, n1, n2);
-		a1 = a1*t*n2 + a2*s*n1;
-		n1 = n1*n2;
-		a1 = mod(a1, n1);
+	/* Square the modulus each step, stopping at p^k. The cofactors are not
+	 * needed after the last step, so they are only lifted before it. */
+	Field *S;
+	for (int e = 1; e < k; ) {
+		e = 2 * e < k ? 2 * e : k;
+		S = init_ring(F->p, e);
+		lift_tree(T, S, e == k);
+		free_field(S);
 	}
 
+	Polynomial **lifted = malloc(sizeof(Polynomial *) * num_factors);
+	take_leaves(lifted, T);
+	free_tree(T);
+
+	/* Store p^k */
+	*power = R->p;
+	free_field(R);
+
+	return lifted;
+}
+
+coeff_t chinese_remainder(coeff_t *product, int num_congruences,
+		coeff_t *remainders, coeff_t *divisors)
+{
+	CRT *C = init_crt(divisors, num_congruences);
+	coeff_t x = crt_combine(C, remainders);
+
 	/* Store product of divisors */
-	*product = n1;
+	*product = C->product;
+
+	free_crt(C);
+	return x;
+}
+
+CRT *init_crt(coeff_t *moduli, int n)
+{
+	int size = n > 0 ? n : 1;
+	CRT *C = malloc(sizeof(CRT));
+	C->n = n;
+	C->moduli = malloc(sizeof(coeff_t) * size);
+	C->prefix = malloc(sizeof(coeff_t) * size);
+	C->inverses = malloc(sizeof(coeff_t) * size);
+	C->fields = malloc(sizeof(Field *) * size);
+
+	/* M_i^-1 mod m_i exists as the moduli are coprime */
+	coeff_t M = 1;
+	for (int i = 0; i < n; i++) {
+		C->moduli[i] = moduli[i];
+		C->prefix[i] = M;
+		C->fields[i] = init_field(moduli[i]);
+		C->inverses[i] = field_inv(C->fields[i], field_elem(C->fields[i], M));
+		M *= moduli[i];
+	}
+	C->product = M;
+
+	return C;
+}
+
+void free_crt(CRT *C)
+{
+	for (int i = 0; i < C->n; i++) {
+		free_field(C->fields[i]);
+	}
+	free(C->fields);
+	free(C->inverses);
+	free(C->prefix);
+	free(C->moduli);
+	free(C);
+}
+
+coeff_t crt_combine(CRT *C, coeff_t *residues)
+{
+	coeff_t x = 0;
+	for (int i = 0; i < C->n; i++) {
+		x = garner_step(C, i, x, residues[i]);
+	}
+	return x;
+}
+
+CRTStream *init_crt_stream(CRT *C, coeff_t **residues, int *counts)
+{
+	int size = C->n > 0 ? C->n : 1;
+	CRTStream *S = malloc(sizeof(CRTStream));
+	S->C = C;
+	S->residues = residues;
+	S->counts = counts;
+	S->digits = calloc(size, sizeof(int));
+	S->partial = malloc(sizeof(coeff_t) * (C->n + 1));
+	S->partial[0] = 0;
+	S->started = FALSE;
+	S->finished = FALSE;
+	return S;
+}
+
+int crt_next(CRTStream *S, coeff_t *x)
+{
+	int n = S->C->n, i;
 
-	return a1;
+	/* turn the odometer, and stop once it wraps around, or straight away if
+	 * some modulus has nothing to choose from */
+	if (S->finished) {
+		return FALSE;
+	}
+	if (!S->started) {
+		S->started = TRUE;
+		for (i = 0; i < n; i++) {
+			if (S->counts[i] <= 0) {
+				S->finished = TRUE;
+				return FALSE;
+			}
+		}
+		i = 0;
+	} else {
+		for (i = n - 1; i >= 0 && ++S->digits[i] == S->counts[i]; i--) {
+			S->digits[i] = 0;
+		}
+		if (i < 0) {
+			S->finished = TRUE;
+			return FALSE;
+		}
+	}
+
+	/* x_j is unchanged for j <= i, as it only depends on earlier digits */
+	for (; i < n; i++) {
+		S->partial[i + 1] = garner_step(S->C, i, S->partial[i],
+				S->residues[i][S->digits[i]]);
+	}
+	*x = S->partial[n];
+	return TRUE;
+}
+
+void free_crt_stream(CRTStream *S)
+{
+	free(S->partial);
+	free(S->digits);
+	free(S);
 }
 
 /* --- utility functions -----------------------------------------------------*/
 
-/** Evaluate polynomial f(x) mod m */
-int evaluate(Polynomial *f, int x, int m)
+/** Builds a balanced tree over n factors mod p, with monic copies of them at
+ * the leaves, their products above and the Bezout cofactors of the children at
+ * each inner node */
+FactorTree *build_tree(Polynomial **factors, int n, Field *F)
 {
-	int val = 0, power = 1;
-	for (int i = 0; i <= f->degree; i++) {
-		val += f->coefficients[i] * power;
-		power *= x;
+	FactorTree *T = malloc(sizeof(FactorTree));
+	T->s = T->t = NULL;
+	T->left = T->right = NULL;
+	if (n == 1) {
+		T->poly = monic_p(factors[0], F);
+		return T;
 	}
-	return mod(val, m);
+
+	T->left = build_tree(factors, n / 2, F);
+	T->right = build_tree(factors + n / 2, n - n / 2, F);
+	T->poly = poly_mul(T->left->poly, T->right->poly, F);
+
+	/* the children are coprime, so their gcd is a non-zero constant c, and
+	 * dividing the cofactors by c makes them sum to 1 */
+	Polynomial *g = ext_gcd_p(&T->s, &T->t, T->left->poly, T->right->poly, F);
+	normalize_p(g, F);
+	scale_p(T->s, g->lc_inv, F);
+	scale_p(T->t, g->lc_inv, F);
+	free_polynomial(g);
+
+	return T;
 }
 
-/** Find the inverse of a in Z_m (assumes it exists) */
-int inverse(int a, int m)
+/** Lifts every node below the root of a tree to the modulus of R, given the
+ * root itself there */
+void lift_tree(FactorTree *T, Field *R, int last)
 {
-	int s, t;
-	extended_gcd_z(&s, &t, a, m);
-	return s;
+	if (!T->left) {
+		return;
+	}
+	hensel_step(T, R, last);
+	lift_tree(T->left, R, last);
+	lift_tree(T->right, R, last);
 }
 
+/**
+ * One Hensel step, which lifts g and h with f = gh mod m to f = gh mod m^2,
+ * where f is the node and g, h its children, along with s and t with
+ * sg + th = 1. R is Z_(m^2), or Z_n for any n dividing m^2 that m divides.
+ * Unless it is the last step, the cofactors are lifted too. (von zur Gathen
+ * and Gerhard, Modern Computer Algebra, Algorithm 15.10.)
+ */
+void hensel_step(FactorTree *T, Field *R, int last)
+{
+	Polynomial *g = T->left->poly, *h = T->right->poly;
+	Polynomial *s = T->s, *t = T->t;
+	int dg = g->degree, dh = h->degree;
+	Polynomial *helper, *helper2, *q, *r;
+
+	/* e = f - gh, which is 0 mod m */
+	helper = poly_mul(g, h, R);
+	Polynomial *e = add_p(T->poly, helper, -1, T->poly->degree, R);
+	free_polynomial(helper);
+
+	/* se = qh + r, then g + te + qg and h + r are the new factors */
+	helper = poly_mul(s, e, R);
+	long_div(&q, &r, helper, h, R);
+	free_polynomial(helper);
+
+	helper = poly_mul(t, e, R);
+	helper2 = poly_mul(q, g, R);
+	Polynomial *g_new = add_p(g, helper, 1, dg, R);
+	Polynomial *g_new2 = add_p(g_new, helper2, 1, dg, R);
+	free_polynomial(g_new);
+	g_new = g_new2;
+	free_polynomial(helper2);
+	free_polynomial(helper);
+	Polynomial *h_new = add_p(h, r, 1, dh, R);
+	free_polynomial(q);
+	free_polynomial(r);
+	free_polynomial(e);
+
+	free_polynomial(g);
+	free_polynomial(h);
+	T->left->poly = g_new;
+	T->right->poly = h_new;
+	if (last) {
+		return;
+	}
+
+	/* b = s g_new + t h_new - 1, which is 0 mod m, then with sb = ch + d the
+	 * new cofactors are s - d and t - tb - cg */
+	helper = poly_mul(s, g_new, R);
+	helper2 = poly_mul(t, h_new, R);
+	Polynomial *b = add_p(helper, helper2, 1, dg + dh - 1, R);
+	b->coefficients[0] = field_sub(R, b->coefficients[0], 1);
+	free_polynomial(helper2);
+	free_polynomial(helper);
+
+	helper = poly_mul(s, b, R);
+	long_div(&q, &r, helper, h_new, R);
+	free_polynomial(helper);
+	T->s = add_p(s, r, -1, dh - 1, R);
+
+	helper = poly_mul(t, b, R);
+	helper2 = add_p(t, helper, -1, dg - 1, R);
+	free_polynomial(helper);
+	helper = poly_mul(q, g_new, R);
+	T->t = add_p(helper2, helper, -1, dg - 1, R);
+	free_polynomial(helper);
+	free_polynomial(helper2);
+
+	free_polynomial(q);
+	free_polynomial(r);
+	free_polynomial(b);
+	free_polynomial(s);
+	free_polynomial(t);
+}
+
+/** Moves the leaves of a tree into an array, from left to right, and returns
+ * how many there were */
+int take_leaves(Polynomial **leaves, FactorTree *T)
+{
+	if (!T->left) {
+		leaves[0] = T->poly;
+		T->poly = NULL;
+		return 1;
+	}
+	int n = take_leaves(leaves, T->left);
+	return n + take_leaves(leaves + n, T->right);
+}
+
+/** Frees a tree, and every polynomial still in it */
+void free_tree(FactorTree *T)
+{
+	if (T->left) {
+		free_tree(T->left);
+		free_tree(T->right);
+		free_polynomial(T->s);
+		free_polynomial(T->t);
+	}
+	if (T->poly) {
+		free_polynomial(T->poly);
+	}
+	free(T);
+}
+
+/** Returns a + b if sign is 1, or a - b if it is -1, reduced into R. Terms
+ * above max_degree are dropped, as the callers know them to cancel, and the
+ * degree is lowered to the actual degree. */
+Polynomial *add_p(Polynomial *a, Polynomial *b, int sign, int max_degree,
+		Field *R)
+{
+	int n = a->degree > b->degree ? a->degree : b->degree;
+	n = n < max_degree ? n : max_degree;
+	n = n > 0 ? n : 0;
+	Polynomial *c = init_polynomial(n);
+	coeff_t x, y;
+	for (int i = 0; i <= n; i++) {
+		x = i <= a->degree ? field_elem(R, a->coefficients[i]) : 0;
+		y = i <= b->degree ? field_elem(R, b->coefficients[i]) : 0;
+		c->coefficients[i] = sign > 0 ? field_add(R, x, y)
+			: field_sub(R, x, y);
+	}
+	while (c->degree > 0 && c->coefficients[c->degree] == 0) {
+		c->degree--;
+	}
+	c->lc = c->coefficients[c->degree];
+	c->lc_inv = c->lc == 1 ? 1 : 0;
+	return c;
+}
+
+/** Multiplies every coefficient of a by c in place */
+void scale_p(Polynomial *a, coeff_t c, Field *F)
+{
+	for (int i = 0; i <= a->degree; i++) {
+		a->coefficients[i] = field_mul(F, field_elem(F, a->coefficients[i]),
+				c);
+	}
+	a->lc = 0;
+	a->lc_inv = 0;
+}
+
+/** Returns x_(i+1) = x_i + M_i t_i, where t_i = (r - x_i) M_i^-1 mod m_i, which
+ * is below M_(i+1) and congruent to r mod m_i and to x_i mod M_i */
+coeff_t garner_step(CRT *C, int i, coeff_t x, coeff_t r)
+{
+	Field *R = C->fields[i];
+	coeff_t t = field_sub(R, field_elem(R, r), field_elem(R, x));
+	return x + C->prefix[i] * field_mul(R, t, C->inverses[i]);
+}
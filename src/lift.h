@@ -11,6 +11,34 @@
 
 #include "euclid.h"
 
+/* Constants for combining residues mod a fixed set of pairwise coprime moduli
+ * m_0, ..., m_(n-1) with Garner's algorithm. x is built up one modulus at a
+ * time as x_(i+1) = x_i + M_i t_i, where M_i = m_0 ... m_(i-1) and
+ * t_i = (r_i - x_i) M_i^-1 mod m_i, so every x_i is below M_i and no
+ * intermediate value exceeds the product of the moduli. */
+typedef struct crt {
+	int n;                    /* the number of moduli */
+	coeff_t *moduli;          /* m_i */
+	coeff_t *prefix;          /* M_i, the product of the moduli before m_i */
+	coeff_t *inverses;        /* M_i^-1 mod m_i */
+	Field **fields;           /* a context for arithmetic mod each m_i */
+	coeff_t product;          /* the product of all the moduli */
+} CRT;
+
+/* Every combination of a residue from a list for each modulus of a CRT, in the
+ * order of an odometer whose last digit turns fastest. Moving to the next one
+ * only redoes the steps of Garner's algorithm from the first digit that
+ * changed, which is usually just the last. */
+typedef struct crt_stream {
+	CRT *C;
+	coeff_t **residues;       /* residues[i] lists the choices mod m_i */
+	int *counts;              /* the number of choices mod each m_i */
+	int *digits;              /* the choice currently taken mod each m_i */
+	coeff_t *partial;         /* partial[i] is x_i for the current digits */
+	int started;              /* set once the first combination is taken */
+	int finished;             /* set once every combination has been taken */
+} CRTStream;
+
 /** 
  * Checks if a root of a polynomial has multiplicity 1 by evaluating its
  * derivative at root. If f'(root) == 0, it is a simple root. Does not check if
@@ -20,11 +48,11 @@
  *     pointer to the polynomial, f(x)
  * @param[in] root
  *     a root of the polynomial
- * @param[in] m
- *     the divisor, which specifies the ring Z_m that we are working over
+ * @param[in] F
+ *     the field Z_m that we are working over
  * @return    true if root is a simple root of f, else false
  */
-int is_simple_root(Polynomial *f, int root, int m);
+int is_simple_root(Polynomial *f, coeff_t root, Field *F);
 
 
 /** 
@@ -37,32 +65,185 @@ int is_simple_root(Polynomial *f, int root, int m);
  *     the polynomial
  * @param[in]  root
  *     a simple root of the polynomial
- * @param[in]  p
- *     specifies ring of integers, Z_p, that we are working over
+ * @param[in]  F
+ *     the field Z_p that root lives in
  * @param[in]  k
- *     the power that p should be raised to
+ *     the power that p should be raised to, with p^k < 2^COEFF_MAX_BITS
  * @return     a root of the polynomial mod p^k
  */
-int hensel(int *power, Polynomial *f, int root, int p, int k);
+coeff_t hensel(coeff_t *power, Polynomial *f, coeff_t root, Field *F, int k);
+
+/**
+ * Lifts several simple roots of a polynomial mod p to roots mod p^k at once,
+ * with Newton's iteration. Each step squares the modulus, so only about log2 k
+ * steps are needed, and the inverse of the derivative at each root is carried
+ * along to the new precision rather than recomputed. The roots share the ring
+ * of each step, and one inversion mod p covers all of them.
+ *
+ * @param[out]    power
+ *     pointer to where p^k should be written
+ * @param[in,out] roots
+ *     array of n simple roots of f mod p, overwritten by the lifted roots
+ * @param[in]     n
+ *     the number of roots
+ * @param[in]     f
+ *     the polynomial, with integer coefficients
+ * @param[in]     F
+ *     the field Z_p that the roots live in
+ * @param[in]     k
+ *     the power that p should be raised to, with p^k < 2^COEFF_MAX_BITS
+ */
+void hensel_roots(coeff_t *power, coeff_t *roots, int n, Polynomial *f,
+		Field *F, int k);
+
+/**
+ * Finds every root mod p^k of a polynomial, given every root of it mod p. A
+ * simple root lifts to exactly one root, which hensel_roots finds. A multiple
+ * root r mod p^j, where p divides f'(r), lifts to p roots mod p^(j + 1) if p^(j
+ * + 1) divides f(r), and to none otherwise, so those are followed one power at
+ * a time and their number may grow quickly.
+ *
+ * @param[out] num_roots
+ *     pointer to where the number of roots mod p^k should be written, or -1 if
+ *     there are more than max_roots
+ * @param[in]  roots
+ *     array of the n distinct roots of f mod p, in Z_p
+ * @param[in]  n
+ *     the number of roots mod p
+ * @param[in]  f
+ *     the polynomial, with integer coefficients
+ * @param[in]  F
+ *     the field Z_p that the roots live in
+ * @param[in]  k
+ *     the power that p should be raised to, with p^k < 2^COEFF_MAX_BITS
+ * @param[in]  max_roots
+ *     the most roots that should be returned
+ * @return     an array of the roots mod p^k, in no particular order, or NULL if
+ *             there are more than max_roots
+ */
+coeff_t *lift_roots(int *num_roots, coeff_t *roots, int n, Polynomial *f,
+		Field *F, int k, int max_roots);
+
+/**
+ * Lifts a factorisation of a polynomial mod p to one mod p^k, for every factor
+ * at once. The factors are kept as the leaves of a balanced binary tree, whose
+ * inner nodes hold the products of the leaves below them, along with Bezout
+ * cofactors s and t for their two children, with s * left + t * right = 1.
+ * Each step squares the modulus and lifts every node from the root down, the
+ * cofactors along with the factors, so a step costs O(M(d) log r) for r
+ * factors of total degree d, and only about log2 k steps are needed.
+ *
+ * @param[out] power
+ *     pointer to where p^k should be written
+ * @param[in]  f
+ *     the polynomial, with integer coefficients and its leading coefficient
+ *     not divisible by p
+ * @param[in]  factors
+ *     array of pairwise coprime factors of f mod p, such as those found by
+ *     berlekamp, whose product is f up to a constant factor
+ * @param[in]  num_factors
+ *     the number of factors, at least 1
+ * @param[in]  F
+ *     the field Z_p that the factors are over
+ * @param[in]  k
+ *     the power that p should be raised to, with p^k < 2^COEFF_MAX_BITS
+ * @return     an array of num_factors monic polynomials over Z_(p^k), in the
+ *             same order as factors, whose product is f divided by its leading
+ *             coefficient mod p^k. The array and every polynomial in it should
+ *             be freed by the caller.
+ */
+Polynomial **hensel_factors(coeff_t *power, Polynomial *f,
+		Polynomial **factors, int num_factors, Field *F, int k);
 
 /**
  * Takes in the remainders after the Euclidean division of some integer x by the
  * corresponding divisors, and returns the remainder of x divided by the product
  * of these divisors (mod the product). Assumes the divisors are coprime. This
  * algorithm is based on the constructive proof of the Chinese remainder
- * theorem.
+ * theorem. The product of the divisors should be below 2^COEFF_MAX_BITS.
  *
  * @param[out] product
  *     pointer to where the product of the divisors should be stored
  * @param[in] num_congruences
  *     the number of equations in the system of congruences
- * @param[in] remainder
+ * @param[in] remainders
  *     array of integers containing remainders after division
  * @param[in] divisors
  *     array of integers containing the divisors used in equations
  * @return    x mod the product of the divisors
  */
-int chinese_remainder(int *product, int num_congruences, int *remainders,
-		int *divisors);
+coeff_t chinese_remainder(coeff_t *product, int num_congruences,
+		coeff_t *remainders, coeff_t *divisors);
+
+/**
+ * Precomputes what Garner's algorithm needs to combine residues mod a set of
+ * pairwise coprime moduli, so that each combination afterwards costs one
+ * multiplication and one reduction per modulus and no inversions.
+ *
+ * @param[in] moduli
+ *     array of the moduli, each at least 2, whose product should be below
+ *     2^COEFF_MAX_BITS
+ * @param[in] n
+ *     the number of moduli
+ * @return    a pointer to the new constants
+ */
+CRT *init_crt(coeff_t *moduli, int n);
+
+/**
+ * Frees the constants made by init_crt.
+ *
+ * @param[in] C
+ *     the constants to be freed
+ */
+void free_crt(CRT *C);
+
+/**
+ * Finds x mod the product of the moduli, given x mod each of them.
+ *
+ * @param[in] C
+ *     the constants for the moduli
+ * @param[in] residues
+ *     array of x mod each modulus, in the order the moduli were given
+ * @return    x mod the product of the moduli
+ */
+coeff_t crt_combine(CRT *C, coeff_t *residues);
+
+/**
+ * Starts streaming every combination of a residue mod each modulus of a CRT,
+ * which are only combined as they are asked for with crt_next, so they never
+ * need to be stored together.
+ *
+ * @param[in] C
+ *     the constants for the moduli, which should outlive the stream
+ * @param[in] residues
+ *     array of arrays, the ith listing the residues to choose from mod the ith
+ *     modulus, which should outlive the stream
+ * @param[in] counts
+ *     array of the number of residues in each list
+ * @return    a pointer to the new stream
+ */
+CRTStream *init_crt_stream(CRT *C, coeff_t **residues, int *counts);
+
+/**
+ * Takes the next combination from a stream.
+ *
+ * @param[in,out] S
+ *     the stream
+ * @param[out]    x
+ *     pointer to where the combination, mod the product of the moduli, should
+ *     be written
+ * @return    true if a combination was written, or false once there are none
+ *            left
+ */
+int crt_next(CRTStream *S, coeff_t *x);
+
+/**
+ * Frees a stream made by init_crt_stream, but not the CRT or the residues it
+ * was made from.
+ *
+ * @param[in] S
+ *     the stream to be freed
+ */
+void free_crt_stream(CRTStream *S);
 
 #endif
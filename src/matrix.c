@@ -0,0 +1,95 @@
+/**
+ * @file    matrix.c
+ * @brief   Allocation of flat matrices over Z_p and vectorised row operations.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "field.h"
+#include "matrix.h"
+
+/* --- matrix interface ------------------------------------------------------*/
+
+Matrix *init_matrix(int rows, int cols)
+{
+	Matrix *A = malloc(sizeof(Matrix));
+	A->rows = rows;
+	A->cols = cols;
+
+	/* pad rows to whole blocks, so every row starts on a block boundary */
+	int block = MATRIX_ALIGN / sizeof(coeff_t);
+	A->stride = (cols + block - 1) / block * block;
+
+	size_t size = sizeof(coeff_t) * (size_t) rows * A->stride;
+	A->data = size ? aligned_alloc(MATRIX_ALIGN, size) : NULL;
+	if (size) {
+		memset(A->data, 0, size);
+	}
+
+	return A;
+}
+
+void free_matrix(Matrix *A)
+{
+	free(A->data);
+	free(A);
+}
+
+void swap_rows(Matrix *A, int i, int j)
+{
+	COUNT(row_ops, 1);
+	coeff_t *a = MATRIX_ROW(A, i);
+	coeff_t *b = MATRIX_ROW(A, j);
+	coeff_t helper;
+	for (int k = 0; k < A->cols; k++) {
+		helper = a[k];
+		a[k] = b[k];
+		b[k] = helper;
+	}
+}
+
+void row_mul_add(coeff_t *dst, coeff_t *src, coeff_t factor, int n, Field *F)
+{
+	COUNT(row_ops, 1);
+	int j = 0;
+
+	/* Each entry gets a single product here, so there is nothing to
+	 * accumulate before reducing. Gauss-Jordan cannot defer reductions
+	 * across pivots either, since each pivot is searched for among reduced
+	 * entries. Holding dst in 64-bit lanes would halve the lanes and double
+	 * the memory traffic, and buy nothing over one Montgomery reduction,
+	 * which costs two more multiplications in the lanes the product is
+	 * already in. */
+#if !defined(WIDE_COEFFICIENTS) && defined(__AVX2__)
+	if (F->p % 2 == 1) {
+		/* factor * 2^32, so that reducing a * factor * 2^32 gives a * factor */
+		__m256i f = _mm256_set1_epi32(field_mul(F, factor, F->r));
+		__m256i pinv = _mm256_set1_epi32((int) F->pinv);
+		__m256i p = _mm256_set1_epi32(F->p);
+		for (; j + 8 <= n; j += 8) {
+			__m256i c = _mm256_loadu_si256((__m256i *) (dst + j));
+			__m256i a = _mm256_loadu_si256((__m256i *) (src + j));
+			_mm256_storeu_si256((__m256i *) (dst + j),
+					mul_add_8(c, a, f, pinv, p));
+		}
+	}
+#elif !defined(WIDE_COEFFICIENTS) && defined(__SSE4_1__)
+	if (F->p % 2 == 1) {
+		__m128i f = _mm_set1_epi32(field_mul(F, factor, F->r));
+		__m128i pinv = _mm_set1_epi32((int) F->pinv);
+		__m128i p = _mm_set1_epi32(F->p);
+		for (; j + 4 <= n; j += 4) {
+			__m128i c = _mm_loadu_si128((__m128i *) (dst + j));
+			__m128i a = _mm_loadu_si128((__m128i *) (src + j));
+			_mm_storeu_si128((__m128i *) (dst + j),
+					mul_add_4(c, a, f, pinv, p));
+		}
+	}
+#endif
+	COUNT(reductions, j);
+
+	/* whatever is left over, or everything without vector support */
+	for (; j < n; j++) {
+		dst[j] = field_mul_add(F, dst[j], factor, src[j]);
+	}
+}
@@ -0,0 +1,79 @@
+/**
+ * @file    matrix.h
+ * @brief   A dense matrix over Z_p stored in one allocation, and the row
+ *          operations used to reduce it.
+ *
+ * Rows are stored one after the other, each padded to a whole number of
+ * MATRIX_ALIGN byte blocks, and the data starts on such a boundary. This keeps
+ * every row aligned for vector loads, and keeps whole rows in as few cache
+ * lines as possible.
+ */
+
+#ifndef MATRIX
+#define MATRIX
+
+#include "field.h"
+
+#define MATRIX_ALIGN 64
+
+/* Pointer to the first entry of row i */
+#define MATRIX_ROW(A, i) ((A)->data + (size_t) (i) * (A)->stride)
+
+typedef struct matrix {
+	int rows;
+	int cols;
+	int stride;    /* number of entries from the start of one row to the next */
+	coeff_t *data; /* row-major entries */
+} Matrix;
+
+/**
+ * Allocates memory for and returns a matrix with all its entries set to zero.
+ *
+ * @param[in] rows
+ *     the number of rows in the matrix
+ * @param[in] cols
+ *     the number of columns in the matrix
+ * @return    a pointer to the new matrix
+ */
+Matrix *init_matrix(int rows, int cols);
+
+/**
+ * Frees the memory allocated for a matrix.
+ *
+ * @param[in] A
+ *     the matrix to be freed
+ */
+void free_matrix(Matrix *A);
+
+/**
+ * Swaps two rows of a matrix.
+ *
+ * @param[in] A
+ *     pointer to the matrix
+ * @param[in] i
+ *     the index of the first row
+ * @param[in] j
+ *     the index of the second row
+ */
+void swap_rows(Matrix *A, int i, int j);
+
+/**
+ * Adds a multiple of one row to another, dst = dst + factor * src over Z_p.
+ * With AVX2 or SSE4.1 and int coefficients, 8 or 4 entries are done at once:
+ * products are formed in 64-bit lanes and brought back with one Montgomery
+ * reduction each, which needs p to be odd. Everything else uses field_mul_add.
+ *
+ * @param[in] dst
+ *     the row to be added to
+ * @param[in] src
+ *     the row to be added
+ * @param[in] factor
+ *     the multiple of src to add, an element of Z_p
+ * @param[in] n
+ *     the number of entries in each row
+ * @param[in] F
+ *     the field Z_p whose elements the rows contain
+ */
+void row_mul_add(coeff_t *dst, coeff_t *src, coeff_t factor, int n, Field *F);
+
+#endif
@@ -0,0 +1,293 @@
+/**
+ * @file    ntt.c
+ * @brief   Implementation of multiplication with the number theoretic
+ *          transform, directly or over three primes recombined with the CRT.
+ */
+
+#include <stdlib.h>
+#include <pthread.h>
+#include "ntt.h"
+
+/* Primes c * 2^k + 1 with k at least NTT_MAX_LOG, whose product exceeds
+ * n * (p - 1)^2 for every p that fits in a coeff_t and n up to 2^NTT_MAX_LOG */
+#ifdef WIDE_COEFFICIENTS
+static const coeff_t ntt_primes[3] = {
+	4179340454199820289LL, /* 29 * 2^57 + 1 */
+	1945555039024054273LL, /* 27 * 2^56 + 1 */
+	882705526964617217LL   /* 49 * 2^54 + 1 */
+};
+#else
+static const coeff_t ntt_primes[3] = {
+	998244353,             /* 119 * 2^23 + 1 */
+	469762049,             /* 7 * 2^26 + 1 */
+	167772161              /* 5 * 2^25 + 1 */
+};
+#endif
+
+typedef struct roots {
+	coeff_t p;          /* the prime these are roots of unity mod */
+	int log;            /* the transform has 2^log points */
+	coeff_t *w;         /* w[j] = omega^j for j < 2^(log-1), omega of order n */
+	coeff_t *w_inv;     /* w_inv[j] = omega^-j */
+	struct roots *next;
+} Roots;
+
+static Roots *cache = NULL;
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* --- function prototypes ---------------------------------------------------*/
+
+static void mul_mod_prime(coeff_t *r, coeff_t *a, int na, coeff_t *b, int nb,
+		int log, Field *Q);
+static void forward(coeff_t *a, int n, coeff_t *w, Field *Q);
+static void inverse(coeff_t *a, int n, coeff_t *w_inv, Field *Q);
+static Roots *get_roots(Field *Q, int log);
+static coeff_t power(Field *F, coeff_t base, coeff_t exp);
+static int transform_log(int len);
+
+/* --- ntt interface ---------------------------------------------------------*/
+
+int ntt_native(int len, Field *F)
+{
+	int log = transform_log(len);
+	return F->prime == F->p && log < COEFF_MAX_BITS
+		&& (F->p - 1) % ((coeff_t) 1 << log) == 0;
+}
+
+void ntt_mul(coeff_t *r, coeff_t *a, int na, coeff_t *b, int nb, Field *F)
+{
+	int len = na + nb - 1;
+	int log = transform_log(len);
+
+	/* Z_p has the roots of unity we need itself */
+	if (ntt_native(len, F)) {
+		mul_mod_prime(r, a, na, b, nb, log, F);
+		return;
+	}
+
+	/* the three primes have no roots of unity of high enough order, so
+	 * multiply each half of the longer operand and add the two products */
+	if (log > NTT_MAX_LOG) {
+		if (na < nb) {
+			ntt_mul(r, b, nb, a, na, F);
+			return;
+		}
+		int h = na / 2;
+		coeff_t *t = malloc(sizeof(coeff_t) * (na - h + nb - 1));
+		ntt_mul(r, a, h, b, nb, F);
+		ntt_mul(t, a + h, na - h, b, nb, F);
+		for (int i = h + nb - 1; i < len; i++) {
+			r[i] = 0;
+		}
+		for (int i = 0; i < na - h + nb - 1; i++) {
+			r[h + i] = field_add(F, r[h + i], t[i]);
+		}
+		free(t);
+		return;
+	}
+
+	Field *Q[3];
+	coeff_t *res[3];
+	for (int i = 0; i < 3; i++) {
+		Q[i] = init_field(ntt_primes[i]);
+		res[i] = malloc(sizeof(coeff_t) * len);
+		mul_mod_prime(res[i], a, na, b, nb, log, Q[i]);
+	}
+
+	/* Garner's form of the CRT: the product is x0 + q0 * x1 + q0 * q1 * x2 with
+	 * each xi in Z_qi, and only that sum needs to be reduced mod p */
+	coeff_t q0_1 = field_elem(Q[1], ntt_primes[0]);
+	coeff_t q0_2 = field_elem(Q[2], ntt_primes[0]);
+	coeff_t inv_q0 = field_inv(Q[1], q0_1);
+	coeff_t inv_q01 = field_inv(Q[2], field_mul(Q[2], q0_2,
+				field_elem(Q[2], ntt_primes[1])));
+	coeff_t m0 = field_elem(F, ntt_primes[0]);
+	coeff_t m01 = field_mul(F, m0, field_elem(F, ntt_primes[1]));
+	coeff_t x0, x1, x2, t;
+
+	for (int i = 0; i < len; i++) {
+		x0 = res[0][i];
+		x1 = field_mul(Q[1], field_sub(Q[1], res[1][i], field_elem(Q[1], x0)),
+				inv_q0);
+		t = field_sub(Q[2], res[2][i], field_elem(Q[2], x0));
+		t = field_sub(Q[2], t, field_mul(Q[2], q0_2, field_elem(Q[2], x1)));
+		x2 = field_mul(Q[2], t, inv_q01);
+
+		t = field_mul_add(F, field_elem(F, x0), m0, field_elem(F, x1));
+		r[i] = field_mul_add(F, t, m01, field_elem(F, x2));
+	}
+
+	for (int i = 0; i < 3; i++) {
+		free(res[i]);
+		free_field(Q[i]);
+	}
+}
+
+void ntt_clear_cache(void)
+{
+	pthread_mutex_lock(&cache_lock);
+	Roots *next;
+	for (Roots *R = cache; R; R = next) {
+		next = R->next;
+		free(R->w);
+		free(R->w_inv);
+		free(R);
+	}
+	cache = NULL;
+	pthread_mutex_unlock(&cache_lock);
+}
+
+/* --- utility functions -----------------------------------------------------*/
+
+/** Writes the product of a and b mod Q to r, with a transform of 2^log points.
+ * 2^log must divide Q - 1. Squares take one forward transform instead of
+ * two. */
+void mul_mod_prime(coeff_t *r, coeff_t *a, int na, coeff_t *b, int nb,
+		int log, Field *Q)
+{
+	int n = 1 << log;
+	int square = a == b && na == nb;
+	Roots *R = get_roots(Q, log);
+
+	coeff_t *fa = malloc(sizeof(coeff_t) * n);
+	coeff_t *fb = square ? fa : malloc(sizeof(coeff_t) * n);
+	for (int i = 0; i < n; i++) {
+		fa[i] = i < na ? field_elem(Q, a[i]) : 0;
+	}
+	forward(fa, n, R->w, Q);
+	if (!square) {
+		for (int i = 0; i < n; i++) {
+			fb[i] = i < nb ? field_elem(Q, b[i]) : 0;
+		}
+		forward(fb, n, R->w, Q);
+	}
+
+	for (int i = 0; i < n; i++) {
+		fa[i] = field_mul(Q, fa[i], fb[i]);
+	}
+	inverse(fa, n, R->w_inv, Q);
+
+	coeff_t n_inv = field_inv(Q, n);
+	for (int i = 0; i < na + nb - 1; i++) {
+		r[i] = field_mul(Q, fa[i], n_inv);
+	}
+
+	if (!square) {
+		free(fb);
+	}
+	free(fa);
+}
+
+/** Decimation in frequency transform of n points, leaving the result in bit
+ * reversed order */
+void forward(coeff_t *a, int n, coeff_t *w, Field *Q)
+{
+	coeff_t u, v;
+	for (int len = n, step = 1; len >= 2; len >>= 1, step <<= 1) {
+		int half = len / 2;
+		for (int i = 0; i < n; i += len) {
+			for (int j = 0; j < half; j++) {
+				u = a[i + j];
+				v = a[i + j + half];
+				a[i + j] = field_add(Q, u, v);
+				a[i + j + half] = field_mul(Q, field_sub(Q, u, v),
+						w[j * step]);
+			}
+		}
+	}
+}
+
+/** Decimation in time transform with inverse roots, taking bit reversed input
+ * back to natural order. The result is n times the inverse transform. */
+void inverse(coeff_t *a, int n, coeff_t *w_inv, Field *Q)
+{
+	coeff_t u, v;
+	for (int len = 2, step = n / 2; len <= n; len <<= 1, step >>= 1) {
+		int half = len / 2;
+		for (int i = 0; i < n; i += len) {
+			for (int j = 0; j < half; j++) {
+				u = a[i + j];
+				v = field_mul(Q, a[i + j + half], w_inv[j * step]);
+				a[i + j] = field_add(Q, u, v);
+				a[i + j + half] = field_sub(Q, u, v);
+			}
+		}
+	}
+}
+
+/** Returns the powers of a root of unity of order 2^log mod Q, building and
+ * caching them the first time they are asked for, or NULL if 2^log does not
+ * divide Q - 1 and there is no such root */
+Roots *get_roots(Field *Q, int log)
+{
+	if ((Q->p - 1) % ((coeff_t) 1 << log) != 0) {
+		return NULL;
+	}
+
+	pthread_mutex_lock(&cache_lock);
+
+	Roots *R;
+	for (R = cache; R; R = R->next) {
+		if (R->p == Q->p && R->log == log) {
+			break;
+		}
+	}
+
+	if (!R) {
+		int n = 1 << log;
+		int half = n > 1 ? n / 2 : 1;
+		R = malloc(sizeof(Roots));
+		R->p = Q->p;
+		R->log = log;
+		R->w = malloc(sizeof(coeff_t) * half);
+		R->w_inv = malloc(sizeof(coeff_t) * half);
+
+		/* g^((Q-1)/n) has order n exactly if its (n/2)-th power is -1 */
+		coeff_t omega = 1;
+		for (coeff_t g = 2; n > 1; g++) {
+			omega = power(Q, g, (Q->p - 1) >> log);
+			if (power(Q, omega, n / 2) == Q->p - 1) {
+				break;
+			}
+		}
+		coeff_t omega_inv = field_inv(Q, omega);
+
+		R->w[0] = 1;
+		R->w_inv[0] = 1;
+		for (int j = 1; j < half; j++) {
+			R->w[j] = field_mul(Q, R->w[j - 1], omega);
+			R->w_inv[j] = field_mul(Q, R->w_inv[j - 1], omega_inv);
+		}
+
+		R->next = cache;
+		cache = R;
+	}
+
+	pthread_mutex_unlock(&cache_lock);
+	return R;
+}
+
+/** Returns base^exp in Z_p, by repeated squaring */
+coeff_t power(Field *F, coeff_t base, coeff_t exp)
+{
+	coeff_t result = 1;
+	base = field_elem(F, base);
+	while (exp > 0) {
+		if (exp & 1) {
+			result = field_mul(F, result, base);
+		}
+		base = field_mul(F, base, base);
+		exp >>= 1;
+	}
+	return result;
+}
+
+/** Returns k for the smallest 2^k >= len */
+int transform_log(int len)
+{
+	int log = 0;
+	while ((1 << log) < len) {
+		log++;
+	}
+	return log;
+}
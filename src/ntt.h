@@ -0,0 +1,77 @@
+/**
+ * @file    ntt.h
+ * @brief   Polynomial multiplication over Z_p with the number theoretic
+ *          transform, for products too large for Karatsuba and Toom-3.
+ *
+ * If 2^k divides p - 1 for a transform of size 2^k, Z_p has the roots of unity
+ * it needs and the product is found directly mod p. Any other p is handled by
+ * multiplying mod three fixed primes of this form, whose product is larger than
+ * any coefficient of the product over the integers, and recombining the three
+ * results with the Chinese Remainder Theorem.
+ *
+ * Powers of the root of unity are tabulated the first time a transform of each
+ * size is done mod each prime, and kept for later products. The cache is shared
+ * between threads, and guarded by a mutex.
+ */
+
+#ifndef NTT
+#define NTT
+
+#include "field.h"
+
+/* Number of coefficients in the smaller operand from which poly_mul uses the
+ * transform, when it can be done directly mod p and when it needs three
+ * primes */
+#define NTT_THRESHOLD 64
+#define NTT_CRT_THRESHOLD 1024
+
+/* Largest k for which all three primes have roots of unity of order 2^k, kept
+ * to what an int can count in the wide build. Longer products are split. */
+#ifdef WIDE_COEFFICIENTS
+#define NTT_MAX_LOG 30
+#else
+#define NTT_MAX_LOG 23
+#endif
+
+/**
+ * Checks whether a product with len coefficients can be transformed directly
+ * mod p, which needs a root of unity of order the next power of two. Prime
+ * powers made by init_ring always use the three primes.
+ *
+ * @param[in] len
+ *     the number of coefficients in the product
+ * @param[in] F
+ *     the field Z_p
+ * @return    non-zero if p is prime and 2^k divides p - 1, for 2^k the first
+ *            power of 2 >= len
+ */
+int ntt_native(int len, Field *F);
+
+/**
+ * Multiplies a, with na coefficients, by b, with nb, over Z_p. The coefficients
+ * should already be in Z_p. A product too long for the three primes, with more
+ * than 2^NTT_MAX_LOG coefficients, is found in pieces by splitting the longer
+ * operand in half.
+ *
+ * @param[out] r
+ *     where the na + nb - 1 coefficients of the product should be written
+ * @param[in]  a
+ *     the coefficients of the first factor, from lowest order up
+ * @param[in]  na
+ *     the number of coefficients in a
+ * @param[in]  b
+ *     the coefficients of the second factor, from lowest order up
+ * @param[in]  nb
+ *     the number of coefficients in b
+ * @param[in]  F
+ *     the field Z_p
+ */
+void ntt_mul(coeff_t *r, coeff_t *a, int na, coeff_t *b, int nb, Field *F);
+
+/**
+ * Frees every table of roots of unity kept by ntt_mul. No product may be in
+ * progress on another thread.
+ */
+void ntt_clear_cache(void);
+
+#endif
@@ -0,0 +1,482 @@
+/**
+ * @file    pool.c
+ * @brief   Implementation of the worker pool.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "counters.h"
+#include "pool.h"
+
+/* A loop being run by pool_for. It is freed by whichever of the caller and the
+ * helpers sharing it leaves last, as a helper may only be started by a worker
+ * long after the caller has returned. */
+typedef struct range {
+	RangeFunction run;
+	void *arg;
+	int n;                    /* the number of iterations */
+	int next;                 /* the next iteration to be started */
+	int done;                 /* iterations finished */
+	int workers;              /* threads that have joined in so far */
+	int refs;                 /* the caller and helpers yet to leave */
+	Counters counts;          /* operations done by the helpers */
+	pthread_mutex_t lock;     /* guards everything above */
+	pthread_cond_t finished;  /* broadcast when done reaches n */
+} Range;
+
+/* A job waiting on a deque */
+typedef struct job {
+	JobFunction run;
+	void *arg;
+} Job;
+
+/* The jobs spawned by one thread, oldest at top and newest just below bottom */
+typedef struct deque {
+	Job *jobs;
+	int top;
+	int bottom;
+	int size;                 /* room in jobs */
+	pthread_mutex_t lock;     /* guards everything above */
+} Deque;
+
+/* A tree of jobs being run by pool_fork. Like a Range, it is freed by whoever
+ * leaves it last. */
+struct scheduler {
+	Deque *deques;            /* one for each thread that may take part */
+	int width;                /* the number of deques */
+	int workers;              /* threads that have joined in so far */
+	int queued;               /* jobs waiting on a deque */
+	int running;              /* jobs taken from a deque but not finished */
+	int idle;                 /* threads waiting for a job */
+	int refs;                 /* the caller and helpers yet to leave */
+	Counters counts;          /* operations done by the helpers */
+	pthread_mutex_t lock;     /* guards the counts above */
+	pthread_cond_t more;      /* signalled when a job is queued, broadcast when
+	                           * the tree is finished */
+};
+
+static Pool *shared = NULL;
+
+/* --- function prototypes ---------------------------------------------------*/
+
+static void *work(void *arg);
+static void help(void *arg);
+static void run_range(Range *R, int worker);
+static void leave_range(Range *R);
+static void steal_help(void *arg);
+static void run_jobs(Scheduler *S, int worker);
+static int take_job(Scheduler *S, int worker, Job *J);
+static void leave_scheduler(Scheduler *S);
+static void count_for_caller(Counters *counts, Counters *before);
+static void merge_counts(Counters *counts);
+
+/* --- pool interface --------------------------------------------------------*/
+
+Pool *init_pool(int num_threads)
+{
+	Pool *P = malloc(sizeof(Pool));
+	P->num_threads = num_threads > 0 ? num_threads : num_processors();
+	P->threads = malloc(sizeof(pthread_t) * P->num_threads);
+	P->head = NULL;
+	P->tail = NULL;
+	P->pending = 0;
+	P->stop = 0;
+	pthread_mutex_init(&P->lock, NULL);
+	pthread_cond_init(&P->ready, NULL);
+	pthread_cond_init(&P->done, NULL);
+
+	for (int i = 0; i < P->num_threads; i++) {
+		pthread_create(P->threads + i, NULL, work, P);
+	}
+
+	return P;
+}
+
+void free_pool(Pool *P)
+{
+	pool_wait(P);
+
+	pthread_mutex_lock(&P->lock);
+	P->stop = 1;
+	pthread_cond_broadcast(&P->ready);
+	pthread_mutex_unlock(&P->lock);
+
+	for (int i = 0; i < P->num_threads; i++) {
+		pthread_join(P->threads[i], NULL);
+	}
+
+	pthread_cond_destroy(&P->done);
+	pthread_cond_destroy(&P->ready);
+	pthread_mutex_destroy(&P->lock);
+	free(P->threads);
+	free(P);
+}
+
+void pool_submit(Pool *P, TaskFunction run, void *arg)
+{
+	Task *T = malloc(sizeof(Task));
+	T->run = run;
+	T->arg = arg;
+	T->next = NULL;
+
+	pthread_mutex_lock(&P->lock);
+	if (P->tail) {
+		P->tail->next = T;
+	} else {
+		P->head = T;
+	}
+	P->tail = T;
+	P->pending++;
+	pthread_cond_signal(&P->ready);
+	pthread_mutex_unlock(&P->lock);
+}
+
+void pool_wait(Pool *P)
+{
+	pthread_mutex_lock(&P->lock);
+	while (P->pending > 0) {
+		pthread_cond_wait(&P->done, &P->lock);
+	}
+	pthread_mutex_unlock(&P->lock);
+}
+
+void pool_for(Pool *P, int n, RangeFunction run, void *arg)
+{
+	int helpers = P ? P->num_threads : 0;
+	if (helpers > n - 1) {
+		helpers = n - 1;
+	}
+	if (helpers <= 0) {
+		for (int i = 0; i < n; i++) {
+			run(arg, i, 0);
+		}
+		return;
+	}
+
+	Range *R = malloc(sizeof(Range));
+	R->run = run;
+	R->arg = arg;
+	R->n = n;
+	R->next = 0;
+	R->done = 0;
+	R->workers = 1;
+	R->refs = 1 + helpers;
+	memset(&R->counts, 0, sizeof(Counters));
+	pthread_mutex_init(&R->lock, NULL);
+	pthread_cond_init(&R->finished, NULL);
+
+	for (int i = 0; i < helpers; i++) {
+		pool_submit(P, help, R);
+	}
+
+	/* the caller is worker 0, and only waits once nothing is left to start */
+	run_range(R, 0);
+	pthread_mutex_lock(&R->lock);
+	while (R->done < R->n) {
+		pthread_cond_wait(&R->finished, &R->lock);
+	}
+	merge_counts(&R->counts);
+	pthread_mutex_unlock(&R->lock);
+	leave_range(R);
+}
+
+void pool_fork(Pool *P, JobFunction run, void *arg)
+{
+	int helpers = P ? P->num_threads : 0;
+	Scheduler *S = malloc(sizeof(Scheduler));
+	S->width = helpers + 1;
+	S->deques = malloc(sizeof(Deque) * S->width);
+	for (int i = 0; i < S->width; i++) {
+		S->deques[i].size = 16;
+		S->deques[i].jobs = malloc(sizeof(Job) * S->deques[i].size);
+		S->deques[i].top = 0;
+		S->deques[i].bottom = 0;
+		pthread_mutex_init(&S->deques[i].lock, NULL);
+	}
+	S->workers = 1;
+	S->queued = 0;
+	S->running = 1;
+	S->idle = 0;
+	S->refs = 1 + helpers;
+	memset(&S->counts, 0, sizeof(Counters));
+	pthread_mutex_init(&S->lock, NULL);
+	pthread_cond_init(&S->more, NULL);
+
+	for (int i = 0; i < helpers; i++) {
+		pool_submit(P, steal_help, S);
+	}
+
+	/* the root counts as running from the start, so helpers that find nothing
+	 * to steal wait for it rather than leaving */
+	run(S, 0, arg);
+	pthread_mutex_lock(&S->lock);
+	if (--S->running == 0 && S->queued == 0) {
+		pthread_cond_broadcast(&S->more);
+	}
+	pthread_mutex_unlock(&S->lock);
+
+	/* once run_jobs returns, every job has finished and been counted */
+	run_jobs(S, 0);
+	pthread_mutex_lock(&S->lock);
+	merge_counts(&S->counts);
+	pthread_mutex_unlock(&S->lock);
+	leave_scheduler(S);
+}
+
+void pool_spawn(Scheduler *S, int worker, JobFunction run, void *arg)
+{
+	Deque *D = S->deques + worker;
+	pthread_mutex_lock(&D->lock);
+	if (D->bottom == D->size) {
+		/* slide the jobs down to the start, and grow if that is not enough */
+		int n = D->bottom - D->top;
+		if (2 * n > D->size) {
+			D->size *= 2;
+			Job *jobs = malloc(sizeof(Job) * D->size);
+			for (int i = 0; i < n; i++) {
+				jobs[i] = D->jobs[D->top + i];
+			}
+			free(D->jobs);
+			D->jobs = jobs;
+		} else {
+			for (int i = 0; i < n; i++) {
+				D->jobs[i] = D->jobs[D->top + i];
+			}
+		}
+		D->top = 0;
+		D->bottom = n;
+	}
+	D->jobs[D->bottom].run = run;
+	D->jobs[D->bottom].arg = arg;
+	D->bottom++;
+	pthread_mutex_unlock(&D->lock);
+
+	pthread_mutex_lock(&S->lock);
+	S->queued++;
+	if (S->idle > 0) {
+		pthread_cond_signal(&S->more);
+	}
+	pthread_mutex_unlock(&S->lock);
+}
+
+int pool_width(Pool *P)
+{
+	return P ? P->num_threads + 1 : 1;
+}
+
+void set_shared_pool(Pool *P)
+{
+	shared = P;
+}
+
+Pool *shared_pool(void)
+{
+	return shared;
+}
+
+int num_processors(void)
+{
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return n > 0 ? (int) n : 1;
+}
+
+/* --- utility functions -----------------------------------------------------*/
+
+/** Runs tasks from the queue of the pool passed as arg until it is stopped */
+void *work(void *arg)
+{
+	Pool *P = arg;
+	Task *T;
+
+	pthread_mutex_lock(&P->lock);
+	for (;;) {
+		while (!P->head && !P->stop) {
+			pthread_cond_wait(&P->ready, &P->lock);
+		}
+		if (!P->head) {
+			break;
+		}
+
+		T = P->head;
+		P->head = T->next;
+		if (!P->head) {
+			P->tail = NULL;
+		}
+		pthread_mutex_unlock(&P->lock);
+
+		T->run(T->arg);
+		free(T);
+
+		pthread_mutex_lock(&P->lock);
+		if (--P->pending == 0) {
+			pthread_cond_broadcast(&P->done);
+		}
+	}
+	pthread_mutex_unlock(&P->lock);
+
+	return NULL;
+}
+
+/** Joins the loop passed as arg from a worker of the pool */
+void help(void *arg)
+{
+	Range *R = arg;
+	pthread_mutex_lock(&R->lock);
+	int worker = R->workers++;
+	pthread_mutex_unlock(&R->lock);
+
+	run_range(R, worker);
+	leave_range(R);
+}
+
+/** Starts iterations of a loop one after another until none are left */
+void run_range(Range *R, int worker)
+{
+	Counters before;
+	int i;
+	pthread_mutex_lock(&R->lock);
+	while (R->next < R->n) {
+		i = R->next++;
+		pthread_mutex_unlock(&R->lock);
+
+		get_counters(&before);
+		R->run(R->arg, i, worker);
+
+		pthread_mutex_lock(&R->lock);
+		if (worker != 0) {
+			count_for_caller(&R->counts, &before);
+		}
+		if (++R->done == R->n) {
+			pthread_cond_broadcast(&R->finished);
+		}
+	}
+	pthread_mutex_unlock(&R->lock);
+}
+
+/** Drops one reference to a loop, freeing it once nobody is left using it */
+void leave_range(Range *R)
+{
+	pthread_mutex_lock(&R->lock);
+	int last = --R->refs == 0;
+	pthread_mutex_unlock(&R->lock);
+
+	if (last) {
+		pthread_cond_destroy(&R->finished);
+		pthread_mutex_destroy(&R->lock);
+		free(R);
+	}
+}
+
+/** Joins the tree of jobs passed as arg from a worker of the pool */
+void steal_help(void *arg)
+{
+	Scheduler *S = arg;
+	pthread_mutex_lock(&S->lock);
+	int worker = S->workers++;
+	pthread_mutex_unlock(&S->lock);
+
+	run_jobs(S, worker);
+	leave_scheduler(S);
+}
+
+/** Runs jobs of a tree, from the thread's own deque or stolen from others,
+ * until every job has finished */
+void run_jobs(Scheduler *S, int worker)
+{
+	Job J = { NULL, NULL };
+	Counters before;
+	for (;;) {
+		if (take_job(S, worker, &J)) {
+			get_counters(&before);
+			J.run(S, worker, J.arg);
+			pthread_mutex_lock(&S->lock);
+			if (worker != 0) {
+				count_for_caller(&S->counts, &before);
+			}
+			if (--S->running == 0 && S->queued == 0) {
+				pthread_cond_broadcast(&S->more);
+			}
+			pthread_mutex_unlock(&S->lock);
+			continue;
+		}
+
+		/* nothing to take, so wait for a spawn, or for the last job to end */
+		pthread_mutex_lock(&S->lock);
+		if (S->queued == 0 && S->running == 0) {
+			pthread_mutex_unlock(&S->lock);
+			return;
+		}
+		if (S->queued == 0) {
+			S->idle++;
+			pthread_cond_wait(&S->more, &S->lock);
+			S->idle--;
+		}
+		pthread_mutex_unlock(&S->lock);
+	}
+}
+
+/** Takes the newest job from the thread's own deque, or failing that steals
+ * the oldest from another, and returns whether it found one */
+int take_job(Scheduler *S, int worker, Job *J)
+{
+	Deque *D;
+	int found = 0;
+	for (int i = 0; i < S->width && !found; i++) {
+		D = S->deques + (worker + i) % S->width;
+		pthread_mutex_lock(&D->lock);
+		if (D->top < D->bottom) {
+			*J = i == 0 ? D->jobs[--D->bottom] : D->jobs[D->top++];
+			found = 1;
+		}
+		pthread_mutex_unlock(&D->lock);
+	}
+
+	if (found) {
+		pthread_mutex_lock(&S->lock);
+		S->queued--;
+		S->running++;
+		pthread_mutex_unlock(&S->lock);
+	}
+	return found;
+}
+
+/** Drops one reference to a tree of jobs, freeing it once nobody is left
+ * using it */
+void leave_scheduler(Scheduler *S)
+{
+	pthread_mutex_lock(&S->lock);
+	int last = --S->refs == 0;
+	pthread_mutex_unlock(&S->lock);
+
+	if (last) {
+		for (int i = 0; i < S->width; i++) {
+			pthread_mutex_destroy(&S->deques[i].lock);
+			free(S->deques[i].jobs);
+		}
+		free(S->deques);
+		pthread_cond_destroy(&S->more);
+		pthread_mutex_destroy(&S->lock);
+		free(S);
+	}
+}
+
+/** Moves what the calling helper has done since before from its own counts to
+ * counts, which are later merged into those of the thread it was helping */
+void count_for_caller(Counters *counts, Counters *before)
+{
+	Counters after, done;
+	get_counters(&after);
+	sub_counters(&done, &after, before);
+	add_counters(counts, &done);
+	set_counters(before);
+}
+
+/** Adds counts collected from helpers to those of the calling thread */
+void merge_counts(Counters *counts)
+{
+	Counters mine;
+	get_counters(&mine);
+	add_counters(&mine, counts);
+	set_counters(&mine);
+}
@@ -0,0 +1,183 @@
+/**
+ * @file    pool.h
+ * @brief   A fixed set of worker threads that run tasks taken from a shared
+ *          queue, in the order they were submitted.
+ *
+ * Starting a thread costs far more than most of the work done here, so the
+ * threads are started once and then kept waiting on a condition variable until
+ * there is something for them to do. Tasks must not wait for other tasks of
+ * the same pool to finish, as every worker may be waiting at once. pool_for is
+ * safe to call from a task, as the caller does whatever iterations the workers
+ * are too busy to take.
+ *
+ * pool_fork runs a tree of jobs, where each job may spawn more, with work
+ * stealing: every thread taking part has a deque of its own, pushes the jobs it
+ * spawns on the bottom and takes its next job from there too, so it carries on
+ * depth first with what it just made. A thread whose deque is empty steals the
+ * oldest job from the top of another's, which is the biggest piece of work left
+ * there. Threads only meet on a deque when one of them is out of work.
+ *
+ * A program may also set one pool as the shared pool, which the factorisation
+ * routines use to spread a single large factorisation over several threads.
+ * Without one they run on the calling thread alone.
+ */
+
+#ifndef POOL
+#define POOL
+
+#include <pthread.h>
+
+/* A unit of work, run on whichever worker takes it */
+typedef void (*TaskFunction)(void *arg);
+
+/* One iteration i of a loop run by pool_for. worker is below pool_width of the
+ * pool, and no two iterations with the same worker run at once, so it can
+ * index scratch space kept for each thread. */
+typedef void (*RangeFunction)(void *arg, int i, int worker);
+
+typedef struct scheduler Scheduler;
+
+/* A job of a tree run by pool_fork, run on the thread numbered worker, which
+ * is below pool_width of the pool. It may spawn more jobs on S. */
+typedef void (*JobFunction)(Scheduler *S, int worker, void *arg);
+
+typedef struct task {
+	TaskFunction run;
+	void *arg;                /* passed to run */
+	struct task *next;        /* the task submitted after this one */
+} Task;
+
+typedef struct pool {
+	pthread_t *threads;
+	int num_threads;
+	Task *head;               /* the next task to be run */
+	Task *tail;               /* the task submitted last */
+	int pending;              /* tasks submitted but not yet finished */
+	int stop;                 /* set when the workers should exit */
+	pthread_mutex_t lock;     /* guards everything above */
+	pthread_cond_t ready;     /* signalled when a task is queued, or on stop */
+	pthread_cond_t done;      /* broadcast when pending reaches zero */
+} Pool;
+
+/**
+ * Starts a pool of worker threads.
+ *
+ * @param[in] num_threads
+ *     the number of workers, or 0 for one per online processor
+ * @return    a pointer to the new pool
+ */
+Pool *init_pool(int num_threads);
+
+/**
+ * Waits for every task submitted to a pool to finish, then stops its workers
+ * and frees it.
+ *
+ * @param[in] P
+ *     the pool to be freed
+ */
+void free_pool(Pool *P);
+
+/**
+ * Queues a task to be run on one of the workers of a pool. Tasks are started
+ * in the order they are submitted, but may finish in any order.
+ *
+ * @param[in] P
+ *     the pool to run the task on
+ * @param[in] run
+ *     the function to be called
+ * @param[in] arg
+ *     the argument it should be called with
+ */
+void pool_submit(Pool *P, TaskFunction run, void *arg);
+
+/**
+ * Waits until every task submitted to a pool so far has finished. Must not be
+ * called from one of its own workers.
+ *
+ * @param[in] P
+ *     the pool to wait for
+ */
+void pool_wait(Pool *P);
+
+/**
+ * Runs run(arg, i, worker) for every i from 0 to n - 1, on the calling thread
+ * and any workers of a pool that are free, and returns once every iteration
+ * has finished. Iterations are started in order, but may finish in any order.
+ *
+ * @param[in] P
+ *     the pool to share the loop with, or NULL to run it on the calling thread
+ * @param[in] n
+ *     the number of iterations
+ * @param[in] run
+ *     the function to be called for each iteration
+ * @param[in] arg
+ *     the argument it should be called with
+ */
+void pool_for(Pool *P, int n, RangeFunction run, void *arg);
+
+/**
+ * Runs run(S, 0, arg) on the calling thread as the root of a tree of jobs, and
+ * returns once it and every job spawned from it have finished. Jobs are shared
+ * with any workers of a pool that are free, which steal them from each other.
+ *
+ * @param[in] P
+ *     the pool to share the jobs with, or NULL to run them all on the calling
+ *     thread
+ * @param[in] run
+ *     the root job
+ * @param[in] arg
+ *     the argument it should be called with
+ */
+void pool_fork(Pool *P, JobFunction run, void *arg);
+
+/**
+ * Spawns a job of the tree being run on S. It is pushed on the deque of the
+ * calling thread, and is run later by that thread or one that steals it.
+ *
+ * @param[in] S
+ *     the scheduler passed to the calling job
+ * @param[in] worker
+ *     the thread number passed to the calling job
+ * @param[in] run
+ *     the job to be run
+ * @param[in] arg
+ *     the argument it should be called with
+ */
+void pool_spawn(Scheduler *S, int worker, JobFunction run, void *arg);
+
+/**
+ * Returns the number of threads that may take part in a loop run by pool_for,
+ * or in a tree of jobs run by pool_fork, one more than the number of workers,
+ * as the caller takes part too.
+ *
+ * @param[in] P
+ *     the pool, or NULL
+ * @return    the number of threads, which is 1 if P is NULL
+ */
+int pool_width(Pool *P);
+
+/**
+ * Sets the pool used by the factorisation routines. This is not locked, so it
+ * should be done before any factorisation starts, and the pool should not be
+ * freed until they are finished or the shared pool is set back to NULL.
+ *
+ * @param[in] P
+ *     the pool to share, or NULL to run everything on the calling thread
+ */
+void set_shared_pool(Pool *P);
+
+/**
+ * Returns the pool used by the factorisation routines.
+ *
+ * @return    the shared pool, or NULL if there is none
+ */
+Pool *shared_pool(void);
+
+/**
+ * Returns the number of processors online, which is the default pool size.
+ *
+ * @return    the number of processors, at least 1
+ */
+int num_processors(void);
+
+#endif
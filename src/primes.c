@@ -0,0 +1,275 @@
+/**
+ * @file    primes.c
+ * @brief   Implementation of primality testing with Miller-Rabin and integer
+ *          factorisation with trial division and Pollard's rho.
+ */
+
+#include <stdlib.h>
+#include "primes.h"
+
+/* Most prime factors, counted with multiplicity, of a value of coeff_t */
+#define PRIMES_MAX_FACTORS 64
+
+/* Number of steps of the rho iteration whose differences are multiplied
+ * together before one gcd checks them all */
+#define PRIMES_RHO_BATCH 128
+
+/* --- type definitions ------------------------------------------------------*/
+
+typedef unsigned long long u64;
+__extension__ typedef unsigned __int128 u128;
+
+typedef struct montgomery {
+	u64 n;                    /* the odd modulus, below 2^63 */
+	u64 ninv;                 /* -n^-1 mod 2^64 */
+	u64 r2;                   /* 2^128 mod n, which takes values into form */
+} Montgomery;
+
+/* --- function prototypes ---------------------------------------------------*/
+
+static void init_montgomery(Montgomery *M, u64 n);
+static u64 redc(Montgomery *M, u128 t);
+static u64 to_montgomery(Montgomery *M, u64 a);
+static u64 mont_mul(Montgomery *M, u64 a, u64 b);
+static u64 mont_pow(Montgomery *M, u64 a, u64 e);
+static int miller_rabin(u64 n);
+static u64 rho(u64 n);
+static void split_all(u64 *primes, int *count, u64 n);
+static u64 gcd(u64 a, u64 b);
+static int compare_u64(const void *a, const void *b);
+
+/* --- primes interface ------------------------------------------------------*/
+
+int is_prime(coeff_t n)
+{
+	if (n < 2) {
+		return 0;
+	}
+	static const int small[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
+	for (int i = 0; i < 12; i++) {
+		if (n % small[i] == 0) {
+			return n == small[i];
+		}
+	}
+	return n < 41 * 41 || miller_rabin((u64) n);
+}
+
+PrimePower *factor_integer(int *n, coeff_t x)
+{
+	u64 primes[PRIMES_MAX_FACTORS];
+	int count = 0;
+
+	/* sieve the primes below the limit, and divide them out of x */
+	u64 y = (u64) x;
+	char *composite = calloc(PRIMES_SIEVE_LIMIT, 1);
+	for (u64 p = 2; p < PRIMES_SIEVE_LIMIT && p * p <= y; p++) {
+		if (composite[p]) {
+			continue;
+		}
+		for (u64 q = p * p; q < PRIMES_SIEVE_LIMIT; q += p) {
+			composite[q] = 1;
+		}
+		while (y % p == 0) {
+			primes[count++] = p;
+			y /= p;
+		}
+	}
+	free(composite);
+
+	/* what is left has no prime factors below the limit, so if it is below
+	 * the square of the limit it is 1 or prime */
+	if (y > 1) {
+		split_all(primes, &count, y);
+	}
+	qsort(primes, count, sizeof(u64), compare_u64);
+
+	/* gather equal primes into powers */
+	PrimePower *factors = malloc(sizeof(PrimePower) * (count > 0 ? count : 1));
+	*n = 0;
+	for (int i = 0; i < count; i++) {
+		if (*n > 0 && factors[*n - 1].p == (coeff_t) primes[i]) {
+			factors[*n - 1].exp++;
+		} else {
+			factors[*n].p = (coeff_t) primes[i];
+			factors[*n].exp = 1;
+			(*n)++;
+		}
+	}
+
+	return factors;
+}
+
+/* --- utility functions -----------------------------------------------------*/
+
+/** Sets up Montgomery arithmetic mod an odd n below 2^63 */
+void init_montgomery(Montgomery *M, u64 n)
+{
+	M->n = n;
+
+	/* Newton's iteration for n^-1 mod 2^64, each step doubling the correct
+	 * bits, starting from n, which is its own inverse mod 8 */
+	u64 inv = n;
+	for (int i = 0; i < 5; i++) {
+		inv *= 2 - n * inv;
+	}
+	M->ninv = -inv;
+	M->r2 = (u64) (-(u128) n % n);
+}
+
+/** Returns t * 2^-64 mod n, for t < n * 2^64 */
+u64 redc(Montgomery *M, u128 t)
+{
+	u64 m = (u64) t * M->ninv;
+	u64 u = (u64) ((t + (u128) m * M->n) >> 64);
+	return u >= M->n ? u - M->n : u;
+}
+
+/** Returns a * 2^64 mod n, the Montgomery form of a < n */
+u64 to_montgomery(Montgomery *M, u64 a)
+{
+	return redc(M, (u128) a * M->r2);
+}
+
+/** Returns the Montgomery form of the product of two numbers in that form */
+u64 mont_mul(Montgomery *M, u64 a, u64 b)
+{
+	return redc(M, (u128) a * b);
+}
+
+/** Returns a^e in Montgomery form, for a in that form */
+u64 mont_pow(Montgomery *M, u64 a, u64 e)
+{
+	u64 result = to_montgomery(M, 1);
+	while (e > 0) {
+		if (e & 1) {
+			result = mont_mul(M, result, a);
+		}
+		a = mont_mul(M, a, a);
+		e >>= 1;
+	}
+	return result;
+}
+
+/** Miller-Rabin tests of an odd n > 37 to the first 12 prime bases, which
+ * together have no strong pseudoprimes below 2^64 */
+int miller_rabin(u64 n)
+{
+	static const u64 bases[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
+	Montgomery M;
+	init_montgomery(&M, n);
+	u64 one = to_montgomery(&M, 1), minus_one = to_montgomery(&M, n - 1);
+
+	/* n - 1 = d * 2^s with d odd */
+	u64 d = n - 1;
+	int s = 0;
+	while (d % 2 == 0) {
+		d /= 2;
+		s++;
+	}
+
+	u64 a;
+	int i, j;
+	for (i = 0; i < 12; i++) {
+		a = mont_pow(&M, to_montgomery(&M, bases[i]), d);
+		if (a == one || a == minus_one) {
+			continue;
+		}
+		for (j = 1; j < s; j++) {
+			a = mont_mul(&M, a, a);
+			if (a == minus_one) {
+				break;
+			}
+		}
+		if (j == s) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/** Finds a nontrivial factor of an odd composite n with Brent's variant of
+ * Pollard's rho method, iterating y -> y^2 + c and trying new c if a cycle is
+ * found without one */
+u64 rho(u64 n)
+{
+	Montgomery M;
+	init_montgomery(&M, n);
+
+	/* everything is left in Montgomery form, which changes neither the cycle
+	 * structure nor any gcd with n */
+	u64 x, y, ys, q, g, diff;
+	u64 r, k, steps;
+	for (u64 c = 1; ; c++) {
+		y = 2;
+		q = to_montgomery(&M, 1);
+		g = 1;
+		x = ys = y;
+		for (r = 1; g == 1; r *= 2) {
+			x = y;
+			for (u64 i = 0; i < r; i++) {
+				y = mont_mul(&M, y, y) + c;
+				y = y >= n ? y - n : y;
+			}
+
+			/* multiply the differences together, checking them with one
+			 * gcd per batch */
+			for (k = 0; k < r && g == 1; k += steps) {
+				ys = y;
+				steps = r - k < PRIMES_RHO_BATCH ? r - k : PRIMES_RHO_BATCH;
+				for (u64 i = 0; i < steps; i++) {
+					y = mont_mul(&M, y, y) + c;
+					y = y >= n ? y - n : y;
+					diff = x > y ? x - y : y - x;
+					q = mont_mul(&M, q, diff);
+				}
+				g = gcd(q, n);
+			}
+		}
+
+		/* the batch may have overshot to g = n, so step through it again
+		 * one difference at a time */
+		if (g == n) {
+			do {
+				ys = mont_mul(&M, ys, ys) + c;
+				ys = ys >= n ? ys - n : ys;
+				diff = x > ys ? x - ys : ys - x;
+				g = gcd(diff, n);
+			} while (g == 1);
+		}
+		if (g != n) {
+			return g;
+		}
+	}
+}
+
+/** Appends the prime factors of n > 1, which has none below
+ * PRIMES_SIEVE_LIMIT, to primes */
+void split_all(u64 *primes, int *count, u64 n)
+{
+	if (n < (u64) PRIMES_SIEVE_LIMIT * PRIMES_SIEVE_LIMIT || miller_rabin(n)) {
+		primes[(*count)++] = n;
+		return;
+	}
+	u64 d = rho(n);
+	split_all(primes, count, d);
+	split_all(primes, count, n / d);
+}
+
+/** Returns the greatest common divisor of a and b */
+u64 gcd(u64 a, u64 b)
+{
+	u64 t;
+	while (b != 0) {
+		t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+/** Orders 64 bit numbers for qsort */
+int compare_u64(const void *a, const void *b)
+{
+	u64 x = *(const u64 *) a, y = *(const u64 *) b;
+	return (x > y) - (x < y);
+}
@@ -0,0 +1,50 @@
+/**
+ * @file    primes.h
+ * @brief   Prototypes for testing and factorising integers, such as the moduli
+ *          whose roots factor looks for.
+ *
+ * Factors below PRIMES_SIEVE_LIMIT are found by trial division with the primes
+ * from a sieve of Eratosthenes. Whatever is left has only large prime factors,
+ * so it is either prime, which a deterministic Miller-Rabin test decides, or
+ * split by Brent's variant of Pollard's rho method, which finds a factor q in
+ * about sqrt(q) steps. Every value of coeff_t is covered, so 64 bit moduli can
+ * be factorised in the WIDE_COEFFICIENTS build, with all arithmetic done in
+ * Montgomery form mod the number being split.
+ */
+
+#ifndef PRIMES
+#define PRIMES
+
+#include "field.h"
+
+/* Primes below this are found by trial division rather than Pollard's rho */
+#define PRIMES_SIEVE_LIMIT (1 << 12)
+
+typedef struct prime_power {
+	coeff_t p;
+	int exp;
+} PrimePower;
+
+/**
+ * Checks whether a number is prime, with Miller-Rabin tests to the first 12
+ * prime bases, which make no mistakes below 3.3 * 10^24.
+ *
+ * @param[in] n
+ *     the number to be tested
+ * @return    true if n is prime, else false
+ */
+int is_prime(coeff_t n);
+
+/**
+ * Factorises a positive integer into powers of distinct primes.
+ *
+ * @param[out] n
+ *     pointer to where the number of distinct prime factors should be written
+ * @param[in]  x
+ *     the number to be factorised, at least 1
+ * @return     an array of the prime powers whose product is x, in increasing
+ *     order of their primes, which should be freed by the caller
+ */
+PrimePower *factor_integer(int *n, coeff_t x);
+
+#endif
@@ -1,61 +1,79 @@
 /**
  * @file    testberlekamp.c
  * @brief   A driver program to test the implementation of Berlekamp's algorithm
+ *
+ * Run with -c to print the operations counted by the last call of berlekamp,
+ * and by the whole run, if counting was compiled in (see counters.h).
  */
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include "euclid.h"
+#include "matrix.h"
 #include "berlekamp.h"
+#include "cantor.h"
+#include "factorise.h"
+#include "counters.h"
 
 /* --- function prototypes ---------------------------------------------------*/
 
-void scan_matrix(int ***arr, int m, int n);
-void print_matrix(int **arr, int m, int n);
+Matrix *scan_matrix(int m, int n);
+void print_matrix(Matrix *A);
+void print_powers(Polynomial **polys, int *exponents, int n);
 
 /* --- main routine ----------------------------------------------------------*/
 
-int main()
+int main(int argc, char *argv[])
 {
-	int p;
+	int counts = argc > 1 && strcmp(argv[1], "-c") == 0;
+	if (counts && !counters_available()) {
+		fprintf(stderr, "%s: built without COUNT_OPERATIONS, counts will be "
+				"zero\n", argv[0]);
+	}
+	enable_counters(counts);
+
+	coeff_t p;
 	printf("P for Z_p? ");
-	scanf("%d", &p);
+	scanf(COEFF_FMT, &p);
+	Field *F = init_field(p);
 	Polynomial *polynomial = scan_polynomial();
 
-	printf("Working in Z_%d\n", p);
+	printf("Working in Z_" COEFF_FMT "\n", p);
 	print_polynomial(polynomial);
 	printf("\n");
 
-	int **matrix = get_berlekamp_matrix(polynomial, p);
+	Matrix *matrix = get_berlekamp_matrix(polynomial, F);
 	int m = polynomial->degree;
 	printf("Berlekamp matrix:\n");
-	print_matrix(matrix, m, m);
+	print_matrix(matrix);
 
-	subtract_identity(matrix, m, m, p);
+	subtract_identity(matrix, F);
 	printf("Matrix - I\n");
-	print_matrix(matrix, m, m);
+	print_matrix(matrix);
 
-	transpose(&matrix, m, m);
+	transpose(matrix);
 	printf("Transposed\n");
-	print_matrix(matrix, m, m);
+	print_matrix(matrix);
 
-	gauss_jordan(matrix, m, m, p);
+	gauss_jordan(matrix, F);
 	printf("Row reduced\n");
-	print_matrix(matrix, m, m);
+	print_matrix(matrix);
 
-	int **kernel, rank;
-	kernel = null_space(&rank, matrix, m, m, p);
+	Matrix *kernel;
+	int rank;
+	kernel = null_space(&rank, matrix, F);
 	printf("Kernel, rank %d\n", rank);
-	print_matrix(kernel, m - rank, m);
+	print_matrix(kernel);
 
-	Polynomial **subalgebra = kernel_to_arr(kernel, m - rank, m);
+	Polynomial **subalgebra = kernel_to_arr(kernel);
 	printf("Subalgebra\n");
 	for (int i = 0; i < m - rank; i++) {
 		print_polynomial(subalgebra[i]);
 		printf("\n");
 	}
 
-	Polynomial **facs = factors(polynomial, subalgebra, m - rank, p);
+	Polynomial **facs = factors(polynomial, subalgebra, m - rank, F);
 	printf("Factors, nullity %d\n", m - rank);
 	if (facs == NULL) {
 		printf("no non-trivial factors\n");
@@ -73,51 +91,104 @@ int main()
 	}
 
 	int num_factors;
-	facs = berlekamp(&num_factors, polynomial, p);
-	/* FIXME doesn't always create enough factors... */
+	facs = berlekamp(&num_factors, polynomial, F);
 	printf("Berlekamp, %d factors\n", num_factors);
 	for (int i = 0; i < num_factors; i++) {
 		print_polynomial(facs[i]);
 		printf("\n");
 	}
+	if (counts) {
+		Counters c;
+		berlekamp_counters(&c);
+		printf("Counters: ");
+		print_counters(stdout, &c);
+		printf("\n");
+	}
+
+	/* Square free parts, and the factors of those with multiplicities */
+	int num_parts, *exponents;
+	Polynomial **parts = square_free(&num_parts, &exponents, polynomial, F);
+	printf("Square free parts, %d parts\n", num_parts);
+	print_powers(parts, exponents, num_parts);
+
+	/* Factor the parts again with the other algorithm, to compare, since it
+	 * needs square free input where Berlekamp's does not */
+	int num_cz_factors;
+	Polynomial **cz_facs;
+	for (int i = 0; i < num_parts; i++) {
+		cz_facs = cantor_zassenhaus(&num_cz_factors, parts[i], F);
+		printf("Cantor-Zassenhaus on part %d, %d factors\n", i + 1,
+				num_cz_factors);
+		for (int j = 0; j < num_cz_factors; j++) {
+			print_polynomial(cz_facs[j]);
+			printf("\n");
+		}
+		free_polynomials(cz_facs, num_cz_factors);
+	}
+
+	int num_irreducible, *multiplicities;
+	Polynomial **irreducible = full_factorisation(&num_irreducible,
+			&multiplicities, polynomial, F);
+	printf("Factorisation, %d factors\n", num_irreducible);
+	print_powers(irreducible, multiplicities, num_irreducible);
+	if (counts) {
+		Counters c;
+		get_counters(&c);
+		printf("Total counters: ");
+		print_counters(stdout, &c);
+		printf("\n");
+	}
 
 	/* Free allocated memory */
+	free_polynomials(parts, num_parts);
+	free(exponents);
+	free_polynomials(irreducible, num_irreducible);
+	free(multiplicities);
 	free_polynomial(polynomial);
-	free_matrix(matrix, m);
-	free_matrix(kernel, m - rank);
+	free_matrix(matrix);
+	free_matrix(kernel);
 	free_polynomials(subalgebra, m - rank);
 	free_polynomials(facs, num_factors);
+	free_field(F);
 
 	return EXIT_SUCCESS;
 }
 
 /* --- functions -------------------------------------------------------------*/
 
-/** Scans m x n integers into a matrix */
-void scan_matrix(int ***arr, int m, int n)
+/** Scans m x n integers into a new matrix */
+Matrix *scan_matrix(int m, int n)
 {
 	/* initialize matrix */
-	*arr = malloc(sizeof(int *) * m);
-	for (int i = 0; i < m; i++) {
-		(*arr)[i] = malloc(sizeof(int) * n);
-	}
+	Matrix *A = init_matrix(m, n);
 
 	/* scan for values */
 	for (int i = 0; i < m; i++) {
 		for (int j = 0; j < n; j++) {
-			scanf("%d", (*arr)[i] + j);
+			scanf(COEFF_FMT, MATRIX_ROW(A, i) + j);
 		}
 	}
+
+	return A;
 }
 
-/** Prints an m x n matrix to the terminal */
-void print_matrix(int **arr, int m, int n)
+/** Prints a matrix to the terminal */
+void print_matrix(Matrix *A)
 {
-	for (int i = 0; i < m; i++) {
-		for (int j = 0; j < n - 1; j++) {
-			printf("%d ", arr[i][j]);
+	for (int i = 0; i < A->rows; i++) {
+		for (int j = 0; j < A->cols - 1; j++) {
+			printf(COEFF_FMT " ", MATRIX_ROW(A, i)[j]);
 		}
-		printf("%d\n", arr[i][n-1]);
+		printf(COEFF_FMT "\n", MATRIX_ROW(A, i)[A->cols - 1]);
 	}
 }
 
+/** Prints polynomials raised to powers, one per line */
+void print_powers(Polynomial **polys, int *exponents, int n)
+{
+	for (int i = 0; i < n; i++) {
+		printf("(");
+		print_polynomial(polys[i]);
+		printf(")^%d\n", exponents[i]);
+	}
+}
@@ -13,9 +13,10 @@ int main()
 	/* TODO make this more interactive */
 
 	/* get p for field Z_p */
-	int p;
+	coeff_t p;
 	printf("P for Z_p? ");
-	scanf("%d", &p);
+	scanf(COEFF_FMT, &p);
+	Field *F = init_field(p);
 
 	/* Scan polynomials */
 	Polynomial *poly1, *poly2;
@@ -23,7 +24,7 @@ int main()
 	poly2 = scan_polynomial();
 
 	/* Print what program scanned, to make sure it checks out */
-	printf("Working in Z_%d\n", p);
+	printf("Working in Z_" COEFF_FMT "\n", p);
 	print_polynomial(poly1);
 	printf("\n");
 	print_polynomial(poly2);
@@ -31,8 +32,8 @@ int main()
 
 	/* Get formal derivatives */
 	Polynomial *d1, *d2;
-	d1 = get_formal_derivative(poly1, p);
-	d2 = get_formal_derivative(poly2, p);
+	d1 = get_formal_derivative(poly1, F);
+	d2 = get_formal_derivative(poly2, F);
 	printf("Derivative of p1: ");
 	print_polynomial(d1);
 	printf("\nDerivative of p2: ");
@@ -41,7 +42,7 @@ int main()
 
 	/* Divide p1 by p2 and print the quotient and remainder after division */
 	Polynomial *q, *r;
-	long_div(&q, &r, poly1, poly2, p);
+	long_div(&q, &r, poly1, poly2, F);
 	print_polynomial(poly1);
 	printf(" = (");
 	print_polynomial(poly2);
@@ -52,11 +53,28 @@ int main()
 	printf("\n");
 
 	/* Calculate the gcd of p1 and p2 */
-	Polynomial *gcd = gcd_p(poly1, poly2, p);
+	Polynomial *gcd = gcd_p(poly1, poly2, F);
 	printf("gcd(p1, p2) = ");
 	print_polynomial(gcd);
 	printf("\n");
 
+	/* Find Bezout cofactors with s * p1 + t * p2 = gcd(p1, p2) */
+	Polynomial *s, *t;
+	Polynomial *ext = ext_gcd_p(&s, &t, poly1, poly2, F);
+	printf("(");
+	print_polynomial(s);
+	printf(")p1 + (");
+	print_polynomial(t);
+	printf(")p2 = ");
+	print_polynomial(ext);
+	printf("\n");
+
+	/* Multiply p1 and p2 */
+	Polynomial *prod = poly_mul(poly1, poly2, F);
+	printf("p1 * p2 = ");
+	print_polynomial(prod);
+	printf("\n");
+
 	/* free allocated memory */
 	free_polynomial(poly1);
 	free_polynomial(poly2);
@@ -65,6 +83,11 @@ int main()
 	free_polynomial(q);
 	free_polynomial(r);
 	free_polynomial(gcd);
+	free_polynomial(ext);
+	free_polynomial(s);
+	free_polynomial(t);
+	free_polynomial(prod);
+	free_field(F);
 
 	return EXIT_SUCCESS;
 }
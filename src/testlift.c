@@ -2,6 +2,10 @@
  * @file    testlift.c
  * @brief   A driver program to test the implementation of Hensel's lemma and
  *          the remainder theorem.
+ *
+ * After the roots, the input may also give a prime p and a power k, and then
+ * the factorisation of f mod p found by berlekamp is lifted to one mod p^k with
+ * hensel_factors, and the product of the lifted factors is checked against f.
  * @author  L. Foxcroft
  * @date    2022-04-01
  */
@@ -9,8 +13,13 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include "euclid.h"
+#include "berlekamp.h"
 #include "lift.h"
 
+/* --- function prototypes ---------------------------------------------------*/
+
+void lift_factors(Polynomial *f, coeff_t p, int k);
+
 /* --- main routine ----------------------------------------------------------*/
 
 int main()
@@ -33,12 +42,13 @@ int main()
 	printf("Number of roots:\n");
 	scanf("%d", &n);
 
-	int *remainders = malloc(sizeof(int) * n);
-	int *divisors = malloc(sizeof(int) * n);
+	coeff_t *remainders = malloc(sizeof(coeff_t) * n);
+	coeff_t *divisors = malloc(sizeof(coeff_t) * n);
 	int *exponents = malloc(sizeof(int) * n);
 	printf("simple root, prime divisor, power to lift to\n");
 	for (int i = 0; i < n; i++) {
-		scanf("%d %d %d", remainders + i, divisors + i, exponents + i);
+		scanf(COEFF_FMT " " COEFF_FMT " %d", remainders + i, divisors + i,
+				exponents + i);
 	}
 
 	/* Print polynomial to make output easier to follow */
@@ -48,28 +58,39 @@ int main()
 
 	/* Check roots are simple, and lift them if they are */
 	int simple_roots = TRUE;
-	int helper, new_root;
+	coeff_t helper, new_root;
+	Field *F;
 	for (int i = 0; i < n; i++) {
-		if (!is_simple_root(f, remainders[i], divisors[i])) {
-			printf("%d is not a simple root of f(x) mod %d\n",
+		F = init_field(divisors[i]);
+		if (!is_simple_root(f, remainders[i], F)) {
+			printf(COEFF_FMT " is not a simple root of f(x) mod " COEFF_FMT "\n",
 					remainders[i], divisors[i]);
 			simple_roots = FALSE;
 		} else {
-			printf("f(%d) = 0 mod %d -> ", remainders[i], divisors[i]);
-			new_root = hensel(&helper, f, remainders[i], divisors[i],
-					exponents[i]);
+			printf("f(" COEFF_FMT ") = 0 mod " COEFF_FMT " -> ", remainders[i],
+					divisors[i]);
+			new_root = hensel(&helper, f, remainders[i], F, exponents[i]);
 			remainders[i] = new_root;
 			divisors[i] = helper;
-			printf("f(%d) = 0 mod %d\n", remainders[i], divisors[i]);
+			printf("f(" COEFF_FMT ") = 0 mod " COEFF_FMT "\n", remainders[i],
+					divisors[i]);
 		}
+		free_field(F);
 	}
 
 	/* If all the roots were simple, assume they were lifted successfully, and
 	 * use the remainder theorem to find the root mod the product of the
 	 * divisors */
 	if (simple_roots) {
-		int x = chinese_remainder(&helper, n, remainders, divisors);
-		printf("f(%d) = 0 mod %d\n", x, helper);
+		coeff_t x = chinese_remainder(&helper, n, remainders, divisors);
+		printf("f(" COEFF_FMT ") = 0 mod " COEFF_FMT "\n", x, helper);
+	}
+
+	/* Lift the factors of f mod a prime too, if one is given */
+	coeff_t p;
+	int k;
+	if (scanf(COEFF_FMT " %d", &p, &k) == 2) {
+		lift_factors(f, p, k);
 	}
 
 	/* Free allocated memory */
@@ -80,3 +101,71 @@ int main()
 
 	return EXIT_SUCCESS;
 }
+
+/* --- functions -------------------------------------------------------------*/
+
+/** Factorises f mod p with berlekamp, lifts the factors to p^k and prints them,
+ * checking that their product is f divided by its leading coefficient */
+void lift_factors(Polynomial *f, coeff_t p, int k)
+{
+	Field *F = init_field(p);
+	Polynomial *g = copy_polynomial(f);
+	normalize_p(g, F);
+
+	/* Hensel's lemma needs the factors mod p to be coprime, and f to keep its
+	 * degree mod p */
+	Polynomial *d = get_formal_derivative(g, F);
+	Polynomial *h = gcd_p(g, d, F);
+	int square_free = h->degree == 0 && h->coefficients[0] != 0;
+	free_polynomial(h);
+	free_polynomial(d);
+	if (g->degree != f->degree || g->degree < 1 || !square_free) {
+		printf("f(x) is not square free of degree %d mod " COEFF_FMT "\n",
+				f->degree, p);
+		free_polynomial(g);
+		free_field(F);
+		return;
+	}
+
+	int n;
+	coeff_t power;
+	Polynomial **factors = berlekamp(&n, g, F);
+	Polynomial **lifted = hensel_factors(&power, f, factors, n, F, k);
+	printf("%d factors mod " COEFF_FMT " lifted to mod " COEFF_FMT ":\n", n,
+			p, power);
+
+	/* multiply the lifted factors back together mod p^k */
+	Field *R = init_ring(p, k);
+	Polynomial *product = init_polynomial(0), *helper;
+	product->coefficients[0] = 1;
+	for (int i = 0; i < n; i++) {
+		printf("(");
+		print_polynomial(lifted[i]);
+		printf(")\n");
+		helper = poly_mul(product, lifted[i], R);
+		free_polynomial(product);
+		product = helper;
+	}
+
+	/* f / lc(f) mod p^k */
+	Polynomial *monic = copy_polynomial(f);
+	coeff_t lc_inv = field_inv(R, field_elem(R, f->coefficients[f->degree]));
+	for (int i = 0; i <= monic->degree; i++) {
+		monic->coefficients[i] = field_mul(R, field_elem(R,
+					monic->coefficients[i]), lc_inv);
+	}
+	int equal = product->degree == monic->degree;
+	for (int i = 0; equal && i <= monic->degree; i++) {
+		equal = product->coefficients[i] == monic->coefficients[i];
+	}
+	printf("The product of the factors %s f(x) / lc(f) mod " COEFF_FMT "\n",
+			equal ? "is" : "is not", power);
+
+	free_polynomial(monic);
+	free_polynomial(product);
+	free_polynomials(lifted, n);
+	free_polynomials(factors, n);
+	free_field(R);
+	free_polynomial(g);
+	free_field(F);
+}